@@ -0,0 +1,300 @@
+﻿#include "ChunkBenchmark.h"
+
+#include "ChunkDataColumn.h"
+#include "TerrainNoise.h"
+#include "WorldGenerator.h"
+#include "Misc/FileHelper.h"
+#include "Structs/HierarchialGrid.h"
+#include "Structs/HierarchicalDenseCodec.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+
+DEFINE_LOG_CATEGORY(LogChunkBenchmark);
+
+namespace
+{
+	thread_local FChunkBenchmarkAllocations GThreadAllocations;
+
+	/**
+	 * Forwards everything to the allocator it replaced, counting on the way
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInner) : Inner(InInner)
+		{
+		}
+
+		FMalloc* Inner;
+
+		virtual void* Malloc(const SIZE_T Count, const uint32 Alignment) override
+		{
+			Track(Count);
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(const SIZE_T Count, const uint32 Alignment) override
+		{
+			Track(Count);
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, const SIZE_T Count, const uint32 Alignment) override
+		{
+			Track(Count);
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, const SIZE_T Count, const uint32 Alignment) override
+		{
+			Track(Count);
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override
+		{
+			Inner->Free(Original);
+		}
+
+		virtual SIZE_T QuantizeSize(const SIZE_T Count, const uint32 Alignment) override
+		{
+			return Inner->QuantizeSize(Count, Alignment);
+		}
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+		{
+			return Inner->GetAllocationSize(Original, SizeOut);
+		}
+
+		virtual void Trim(const bool bTrimThreadCaches) override
+		{
+			Inner->Trim(bTrimThreadCaches);
+		}
+
+		virtual void SetupTLSCachesOnCurrentThread() override
+		{
+			Inner->SetupTLSCachesOnCurrentThread();
+		}
+
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+		{
+			Inner->ClearAndDisableTLSCachesOnCurrentThread();
+		}
+
+		virtual void UpdateStats() override
+		{
+			Inner->UpdateStats();
+		}
+
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override
+		{
+			Inner->GetAllocatorStats(OutStats);
+		}
+
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override
+		{
+			Inner->DumpAllocatorStats(Ar);
+		}
+
+		virtual bool IsInternallyThreadSafe() const override
+		{
+			return Inner->IsInternallyThreadSafe();
+		}
+
+		virtual bool ValidateHeap() override
+		{
+			return Inner->ValidateHeap();
+		}
+
+		virtual const TCHAR* GetDescriptiveName() override
+		{
+			return Inner->GetDescriptiveName();
+		}
+
+	private:
+		static void Track(const SIZE_T Count)
+		{
+			GThreadAllocations.Count++;
+			GThreadAllocations.Bytes += Count;
+		}
+	};
+
+	/**
+	 * Never deleted, other threads may still go through it after Uninstall
+	 */
+	FCountingMalloc* GCountingMalloc = nullptr;
+}
+
+FChunkBenchmarkAllocations FChunkBenchmarkAllocations::Get()
+{
+	return GThreadAllocations;
+}
+
+void FChunkBenchmarkAllocations::Install()
+{
+	check(IsInGameThread());
+	if (GCountingMalloc && GMalloc == GCountingMalloc)
+	{
+		return;
+	}
+
+	// Blocks allocated before are freed through the proxy, and the other way around after
+	// Uninstall, both end up in the same allocator
+	GCountingMalloc = new FCountingMalloc(GMalloc);
+	GMalloc = GCountingMalloc;
+}
+
+void FChunkBenchmarkAllocations::Uninstall()
+{
+	check(IsInGameThread());
+	if (GCountingMalloc && GMalloc == GCountingMalloc)
+	{
+		GMalloc = GCountingMalloc->Inner;
+	}
+}
+
+FHierarchicalGrid FChunkBenchmarkFixtures::MakeTerrainSection(FRandomStream& Random)
+{
+	FHierarchicalGrid Grid;
+	for (uint8 X = 0; X < FGameConstants::ChunkSize; X++)
+	{
+		for (uint8 Y = 0; Y < FGameConstants::ChunkSize; Y++)
+		{
+			const uint8 Height = (X / 4 + Y / 4 + Random.RandRange(0, 1)) % FGameConstants::ChunkSize;
+			Grid.FillColumnSpan(X, Y, 0, Height, 1);
+		}
+	}
+
+	return Grid;
+}
+
+TArray<FIntVector> FChunkBenchmarkFixtures::MakeSectionPositions(FRandomStream& Random, const int32 Count)
+{
+	TArray<FIntVector> Positions;
+	Positions.Reserve(Count);
+	for (int32 Idx = 0; Idx < Count; Idx++)
+	{
+		Positions.Add(FIntVector(Random.RandRange(0, FGameConstants::ChunkSize - 1),
+		                         Random.RandRange(0, FGameConstants::ChunkSize - 1),
+		                         Random.RandRange(0, FGameConstants::ChunkSize - 1)));
+	}
+
+	return Positions;
+}
+
+FChunkDataColumn FChunkBenchmarkFixtures::MakeNoisyColumn(FRandomStream& Random, const FIntVector2 ColumnPos,
+                                                          const int32 NoisySections)
+{
+	FChunkDataColumn Column{ColumnPos};
+	const auto Buffer = FDenseBlockBuffer::Acquire(FGameConstants::ChunkSize);
+	for (int32 ChunkZ = 0; ChunkZ < NoisySections; ChunkZ++)
+	{
+		for (auto& Block : Buffer->Blocks)
+		{
+			Block = Random.FRand() < 0.9f ? 1 : Random.RandRange(2, 4);
+		}
+
+		FHierarchicalDenseCodec::Encode(*Buffer, Column.ChunkDatas[ChunkZ]);
+	}
+
+	Column.RebuildHeights();
+	return Column;
+}
+
+TArray<FChunkDataColumn> FChunkBenchmarkFixtures::MakeGeneratedColumns(const int32 Count, const int32 RowLength)
+{
+	UWorldGenerator* WorldGenerator = NewObject<UWorldGenerator>();
+	const auto Noise = WorldGenerator->CreateNoise();
+
+	TArray<FChunkDataColumn> Columns;
+	Columns.Reserve(Count);
+	for (int32 ColumnIdx = 0; ColumnIdx < Count; ColumnIdx++)
+	{
+		const FIntVector2 ColumnPos{ColumnIdx % RowLength, ColumnIdx / RowLength};
+		WorldGenerator->GenerateColumn(ColumnPos, *Noise, Columns.Emplace_GetRef(ColumnPos));
+	}
+
+	return Columns;
+}
+
+void FChunkBenchmarkContext::Report(const FString& Suite, const FString& Case,
+                                    const TArray<TPair<FString, double>>& Metrics) const
+{
+	FString Line;
+	for (const auto& [Name, Value] : Metrics)
+	{
+		Line += FString::Printf(TEXT(" %s=%.3f"), *Name, Value);
+	}
+
+	UE_LOG(LogChunkBenchmark, Display, TEXT("[%s] %s:%s"), *Suite, *Case, *Line);
+	Results.Add(FChunkBenchmarkResult{Suite, Case, Metrics});
+}
+
+void FChunkBenchmarkContext::ReportOps(const FString& Suite, const FString& Case,
+                                       const int64 OpCount,
+                                       const FChunkBenchmarkMeasure& Measure) const
+{
+	const double Ops = FMath::Max<int64>(OpCount, 1);
+	Report(Suite, Case, {
+		       {TEXT("NsPerOp"), Measure.Seconds * 1e9 / Ops},
+		       {TEXT("BytesPerOp"), Measure.Allocations.Bytes / Ops},
+		       {TEXT("AllocsPerOp"), Measure.Allocations.Count / Ops}
+	       });
+}
+
+void FChunkBenchmarkContext::ReportColumns(const FString& Suite, const FString& Case,
+                                           const int32 ColumnCount, const double Seconds) const
+{
+	Report(Suite, Case, {
+		       {TEXT("ColumnsPerSec"), ColumnCount / Seconds},
+		       {TEXT("UsPerColumn"), Seconds * 1e6 / ColumnCount}
+	       });
+}
+
+bool FChunkBenchmarkContext::WriteJson(const FString& Path) const
+{
+	FString Json;
+	const auto Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("Platform"), FString(FPlatformProperties::IniPlatformName()));
+	Writer->WriteValue(TEXT("Configuration"), FString(LexToString(FApp::GetBuildConfiguration())));
+	Writer->WriteValue(TEXT("Params"), Params);
+
+	Writer->WriteArrayStart(TEXT("Results"));
+	for (const auto& Result : Results)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("Suite"), Result.Suite);
+		Writer->WriteValue(TEXT("Case"), Result.Case);
+		Writer->WriteObjectStart(TEXT("Metrics"));
+		for (const auto& [Name, Value] : Result.Metrics)
+		{
+			Writer->WriteValue(Name, Value);
+		}
+
+		Writer->WriteObjectEnd();
+		Writer->WriteObjectEnd();
+	}
+
+	Writer->WriteArrayEnd();
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	return FFileHelper::SaveStringToFile(Json, *Path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
+
+bool FChunkBenchmarkContext::WriteCsv(const FString& Path) const
+{
+	FString Csv = TEXT("Suite,Case,Metric,Value\n");
+	for (const auto& Result : Results)
+	{
+		for (const auto& [Name, Value] : Result.Metrics)
+		{
+			Csv += FString::Printf(TEXT("%s,\"%s\",%s,%.6f\n"), *Result.Suite,
+			                       *Result.Case.Replace(TEXT("\""), TEXT("\"\"")), *Name, Value);
+		}
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *Path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
@@ -0,0 +1,183 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogChunkBenchmark, Log, All);
+
+/**
+ * Heap allocations made by the calling thread, counted by a proxy installed over GMalloc
+ * while the benchmark commandlet runs (zero when it isn't installed)
+ */
+struct FChunkBenchmarkAllocations
+{
+	uint64 Count = 0;
+
+	/**
+	 * Requested sizes, a realloc counts its new size
+	 */
+	uint64 Bytes = 0;
+
+	static FChunkBenchmarkAllocations Get();
+
+	static void Install();
+
+	static void Uninstall();
+
+	FChunkBenchmarkAllocations operator-(const FChunkBenchmarkAllocations& Other) const
+	{
+		return {Count - Other.Count, Bytes - Other.Bytes};
+	}
+};
+
+/**
+ * Time and allocations of the calling thread, summed over one or more timed sections, so
+ * setup between them (e.g. copying inputs that get consumed) isn't measured
+ */
+struct FChunkBenchmarkMeasure
+{
+	double Seconds = 0;
+
+	FChunkBenchmarkAllocations Allocations;
+
+	template <typename FunctionType>
+	void Time(FunctionType&& Function)
+	{
+		const FChunkBenchmarkAllocations StartAllocations = FChunkBenchmarkAllocations::Get();
+		const double StartTime = FPlatformTime::Seconds();
+		Function();
+		Seconds += FPlatformTime::Seconds() - StartTime;
+
+		const FChunkBenchmarkAllocations Made = FChunkBenchmarkAllocations::Get() - StartAllocations;
+		Allocations.Count += Made.Count;
+		Allocations.Bytes += Made.Bytes;
+	}
+};
+
+struct FChunkDataColumn;
+struct FHierarchicalGrid;
+
+/**
+ * Inputs shared by the benchmarks, the same for a given random stream
+ */
+struct FChunkBenchmarkFixtures
+{
+	/**
+	 * Terrain like section: block 1 under a height that steps every few blocks, give or take
+	 * one at random
+	 */
+	static FHierarchicalGrid MakeTerrainSection(FRandomStream& Random);
+
+	/**
+	 * Count block positions spread uniformly over a section
+	 */
+	static TArray<FIntVector> MakeSectionPositions(FRandomStream& Random, int32 Count);
+
+	/**
+	 * Column whose NoisySections lowest sections are mostly block 1 with blocks 2 to 4
+	 * sprinkled in, the rest uniform air
+	 */
+	static FChunkDataColumn MakeNoisyColumn(FRandomStream& Random, FIntVector2 ColumnPos,
+	                                        int32 NoisySections = 2);
+
+	/**
+	 * Count columns from the world generator, laid out in rows of RowLength columns
+	 */
+	static TArray<FChunkDataColumn> MakeGeneratedColumns(int32 Count, int32 RowLength);
+
+	/**
+	 * Get every position of a section within Measure, summing the blocks into OutChecksum so
+	 * nothing gets optimized away
+	 */
+	template <typename SectionType>
+	static void TimeLookups(const SectionType& Section, const TArray<FIntVector>& Positions,
+	                        FChunkBenchmarkMeasure& Measure, uint64& OutChecksum)
+	{
+		Measure.Time([&Section, &Positions, &OutChecksum]
+		{
+			for (const auto& Pos : Positions)
+			{
+				OutChecksum += Section.Get(Pos.X, Pos.Y, Pos.Z);
+			}
+		});
+	}
+};
+
+struct FChunkBenchmarkResult
+{
+	FString Suite;
+
+	FString Case;
+
+	TArray<TPair<FString, double>> Metrics;
+};
+
+/**
+ * Passed to every benchmark, holds the commandlet params and collects the results
+ */
+struct FChunkBenchmarkContext
+{
+	explicit FChunkBenchmarkContext(const FString& InParams) : Params(InParams)
+	{
+	}
+
+	FString Params;
+
+	/**
+	 * Everything reported so far, in order
+	 */
+	mutable TArray<FChunkBenchmarkResult> Results;
+
+	int32 GetIntParam(const TCHAR* Name, const int32 Default) const
+	{
+		int32 Value = Default;
+		FParse::Value(*Params, Name, Value);
+		return Value;
+	}
+
+	void Report(const FString& Suite, const FString& Case,
+	            const TArray<TPair<FString, double>>& Metrics) const;
+
+	/**
+	 * Report NsPerOp, BytesPerOp and AllocsPerOp of a measure over OpCount operations
+	 */
+	void ReportOps(const FString& Suite, const FString& Case, int64 OpCount,
+	               const FChunkBenchmarkMeasure& Measure) const;
+
+	/**
+	 * Report ColumnsPerSec and UsPerColumn of ColumnCount columns processed in Seconds
+	 */
+	void ReportColumns(const FString& Suite, const FString& Case, int32 ColumnCount,
+	                   double Seconds) const;
+
+	/**
+	 * {"Platform", "Configuration", "Results": [{"Suite", "Case", "Metrics": {Name: Value}}]}
+	 */
+	bool WriteJson(const FString& Path) const;
+
+	/**
+	 * One Suite,Case,Metric,Value row per metric, so runs can be diffed or concatenated
+	 */
+	bool WriteCsv(const FString& Path) const;
+};
+
+using FChunkBenchmarkFunction = void(*)(FChunkBenchmarkContext& Context);
+
+struct FChunkBenchmarkRegistry
+{
+	static TMap<FString, FChunkBenchmarkFunction>& Get()
+	{
+		static TMap<FString, FChunkBenchmarkFunction> Benchmarks;
+		return Benchmarks;
+	}
+};
+
+/**
+ * Declare one static instance per benchmark, so it can be picked by name with -Bench=Name
+ */
+struct FChunkBenchmarkRegistration
+{
+	FChunkBenchmarkRegistration(const TCHAR* Name, const FChunkBenchmarkFunction Function)
+	{
+		FChunkBenchmarkRegistry::Get().Add(Name, Function);
+	}
+};
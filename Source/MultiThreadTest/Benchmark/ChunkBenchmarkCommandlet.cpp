@@ -0,0 +1,62 @@
+﻿#include "ChunkBenchmarkCommandlet.h"
+
+#include "ChunkBenchmark.h"
+
+UChunkBenchmarkCommandlet::UChunkBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UChunkBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString BenchList;
+	FParse::Value(*Params, TEXT("Bench="), BenchList, false);
+
+	TArray<FString> Selected;
+	BenchList.ParseIntoArray(Selected, TEXT(","));
+
+	FString OutPath;
+	if (!FParse::Value(*Params, TEXT("Out="), OutPath))
+	{
+		OutPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"),
+		                          TEXT("ChunkBenchmark-") + FDateTime::Now().ToString());
+	}
+
+	FChunkBenchmarkContext Context{Params};
+	FChunkBenchmarkAllocations::Install();
+
+	int32 Ran = 0;
+	for (const auto& [Name, Function] : FChunkBenchmarkRegistry::Get())
+	{
+		if (Selected.Num() && !Selected.Contains(Name))
+		{
+			continue;
+		}
+
+		UE_LOG(LogChunkBenchmark, Display, TEXT("Running %s"), *Name);
+		Function(Context);
+		Ran++;
+	}
+
+	FChunkBenchmarkAllocations::Uninstall();
+
+	if (Ran == 0)
+	{
+		UE_LOG(LogChunkBenchmark, Error, TEXT("No benchmark matched '%s'"), *BenchList);
+		return 1;
+	}
+
+	const FString JsonPath = OutPath + TEXT(".json");
+	const FString CsvPath = OutPath + TEXT(".csv");
+	if (!Context.WriteJson(JsonPath) || !Context.WriteCsv(CsvPath))
+	{
+		UE_LOG(LogChunkBenchmark, Error, TEXT("Couldn't write the results to %s"), *OutPath);
+		return 1;
+	}
+
+	UE_LOG(LogChunkBenchmark, Display, TEXT("Results written to %s and %s"), *JsonPath, *CsvPath);
+	return 0;
+}
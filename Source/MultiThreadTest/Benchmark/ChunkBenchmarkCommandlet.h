@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ChunkBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs the registered chunk benchmarks headlessly:
+ * UnrealEditor-Cmd MultiThreadTest.uproject -run=ChunkBenchmark -nullrhi -Bench=Queue
+ *
+ * -Bench takes a comma separated list of benchmark names, all of them run when omitted.
+ * Results are also written to <Out>.json and <Out>.csv, -Out defaults to
+ * Saved/Benchmarks/ChunkBenchmark-<date>. Allocations are counted while it runs, see
+ * FChunkBenchmarkAllocations
+ */
+UCLASS()
+class MULTITHREADTEST_API UChunkBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UChunkBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
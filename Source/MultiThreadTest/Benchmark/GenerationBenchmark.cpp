@@ -0,0 +1,60 @@
+﻿#include "ChunkBenchmark.h"
+#include "ChunkDataColumn.h"
+#include "TerrainNoise.h"
+#include "WorldGenerator.h"
+
+namespace
+{
+	template <typename FunctionType>
+	double TimeColumns(const int32 ColumnCount, FunctionType&& Function)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 ColumnIdx = 0; ColumnIdx < ColumnCount; ColumnIdx++)
+		{
+			Function(FIntVector2{ColumnIdx % 64, ColumnIdx / 64});
+		}
+
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	void RunGenerationBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 ColumnCount = Context.GetIntParam(TEXT("Columns="), 256);
+		UWorldGenerator* WorldGenerator = NewObject<UWorldGenerator>();
+
+		// What FLoadChunkRunnable used to do: generate the whole column once per section
+		Context.ReportColumns(TEXT("Generation"), TEXT("PerSectionGenerate"), ColumnCount,
+		                      TimeColumns(ColumnCount, [WorldGenerator](const FIntVector2 ColumnPos)
+		                      {
+			                      FChunkDataColumn ColumnData{ColumnPos};
+			                      for (int Z = 0; Z < FGameConstants::ChunksInZ; Z++)
+			                      {
+				                      TArray<FHierarchicalGrid> Grids;
+				                      WorldGenerator->Generate(ColumnPos, Grids);
+				                      ColumnData.ChunkDatas = MoveTemp(Grids);
+			                      }
+		                      }));
+
+		// One call of the legacy generator, with its allocations
+		FChunkBenchmarkMeasure GenerateMeasure;
+		GenerateMeasure.Time([WorldGenerator, ColumnCount]
+		{
+			for (int32 ColumnIdx = 0; ColumnIdx < ColumnCount; ColumnIdx++)
+			{
+				TArray<FHierarchicalGrid> Grids;
+				WorldGenerator->Generate(FIntVector2{ColumnIdx % 64, ColumnIdx / 64}, Grids);
+			}
+		});
+		Context.ReportOps(TEXT("Generation"), TEXT("Generate"), ColumnCount, GenerateMeasure);
+
+		const auto Noise = WorldGenerator->CreateNoise();
+		Context.ReportColumns(TEXT("Generation"), TEXT("GenerateColumn"), ColumnCount,
+		                      TimeColumns(ColumnCount, [WorldGenerator, &Noise](const FIntVector2 ColumnPos)
+		                      {
+			                      FChunkDataColumn ColumnData{ColumnPos};
+			                      WorldGenerator->GenerateColumn(ColumnPos, *Noise, ColumnData);
+		                      }));
+	}
+
+	FChunkBenchmarkRegistration GGenerationBenchmark(TEXT("Generation"), &RunGenerationBenchmark);
+}
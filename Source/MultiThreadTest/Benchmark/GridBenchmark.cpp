@@ -0,0 +1,164 @@
+﻿#include "ChunkBenchmark.h"
+#include "Structs/HierarchialGrid.h"
+
+namespace
+{
+	/**
+	 * Grids consumed or modified by an operation are copied this many at a time, outside of
+	 * the timed sections
+	 */
+	constexpr int32 BatchSize = 256;
+
+	/**
+	 * One layer per Z, runs of equal uniform layers between non uniform ones, what
+	 * MergeLayers gets after a layer was split
+	 */
+	TArray<FHierarchicalLayer> MakeUnitLayers(const FHierarchicalGrid& Terrain)
+	{
+		TArray<FHierarchicalLayer> Layers;
+		for (uint8 Z = 0; Z < FGameConstants::ChunkSize; Z++)
+		{
+			if (Z % 4 < 3)
+			{
+				Layers.Add(FHierarchicalLayer{1, static_cast<uint32>(Z / 8 + 1)});
+				continue;
+			}
+
+			const auto Found = Terrain.FindLayer(Z);
+			FHierarchicalLayer Layer = Found.DataPtr ? *Found.DataPtr : Found.Data.GetValue();
+			Layer.Span = 1;
+			Layers.Add(MoveTemp(Layer));
+		}
+
+		return Layers;
+	}
+
+	void RunGridBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 OpCount = FMath::Max(Context.GetIntParam(TEXT("Ops="), 100000), BatchSize);
+		const int32 BatchCount = OpCount / BatchSize;
+
+		FRandomStream Random{1337};
+		const FHierarchicalGrid Terrain = FChunkBenchmarkFixtures::MakeTerrainSection(Random);
+		const TArray<FIntVector> Positions = FChunkBenchmarkFixtures::MakeSectionPositions(Random, OpCount);
+
+		// Keeps the results alive, so nothing gets optimized away
+		uint64 Checksum = 0;
+
+		{
+			FChunkBenchmarkMeasure Measure;
+			FChunkBenchmarkFixtures::TimeLookups(Terrain, Positions, Measure, Checksum);
+			Context.ReportOps(TEXT("Grid"), TEXT("Get"), OpCount, Measure);
+		}
+
+		{
+			FChunkBenchmarkMeasure Measure;
+			Measure.Time([&]
+			{
+				for (const auto& Pos : Positions)
+				{
+					Checksum += Terrain.FindLayer(Pos.Z).StartIdx;
+				}
+			});
+			Context.ReportOps(TEXT("Grid"), TEXT("FindLayer"), OpCount, Measure);
+		}
+
+		// Spans left after every batch, how much each way of editing fragments the grid
+		double SetSpans = 0;
+		double ApplyEditsSpans = 0;
+
+		{
+			FChunkBenchmarkMeasure Measure;
+			for (int32 Batch = 0; Batch < BatchCount; Batch++)
+			{
+				FHierarchicalGrid Grid = Terrain;
+				Measure.Time([&]
+				{
+					for (int32 Idx = Batch * BatchSize; Idx < (Batch + 1) * BatchSize; Idx++)
+					{
+						const FIntVector& Pos = Positions[Idx];
+						Grid.Set(Pos.X, Pos.Y, Pos.Z, Idx % 3);
+					}
+				});
+
+				Checksum += Grid.Layers.Num();
+				SetSpans += Grid.NumSpans();
+			}
+
+			Context.ReportOps(TEXT("Grid"), TEXT("Set"), BatchCount * BatchSize, Measure);
+		}
+
+		{
+			TArray<FBlockEdit> Edits;
+			FChunkBenchmarkMeasure Measure;
+			for (int32 Batch = 0; Batch < BatchCount; Batch++)
+			{
+				FHierarchicalGrid Grid = Terrain;
+				Edits.Reset();
+				for (int32 Idx = Batch * BatchSize; Idx < (Batch + 1) * BatchSize; Idx++)
+				{
+					const FIntVector& Pos = Positions[Idx];
+					Edits.Add(FBlockEdit{
+						static_cast<uint8>(Pos.X), static_cast<uint8>(Pos.Y),
+						static_cast<uint8>(Pos.Z), static_cast<uint32>(Idx % 3)
+					});
+				}
+
+				Measure.Time([&]
+				{
+					Checksum += Grid.ApplyEdits(Edits);
+				});
+
+				ApplyEditsSpans += Grid.NumSpans();
+			}
+
+			Context.ReportOps(TEXT("Grid"), TEXT("ApplyEdits"), BatchCount * BatchSize, Measure);
+		}
+
+		Context.Report(TEXT("Grid"), TEXT("Fragmentation"), {
+			               {TEXT("TerrainSpans"), static_cast<double>(Terrain.NumSpans())},
+			               {TEXT("SpansAfterSet"), SetSpans / BatchCount},
+			               {TEXT("SpansAfterApplyEdits"), ApplyEditsSpans / BatchCount}
+		               });
+
+		{
+			const TArray<FHierarchicalLayer> UnitLayers = MakeUnitLayers(Terrain);
+			TArray<TArray<FHierarchicalLayer>> Inputs;
+
+			FChunkBenchmarkMeasure Measure;
+			for (int32 Batch = 0; Batch < BatchCount; Batch++)
+			{
+				// MergeLayers moves the non uniform layers out of its input
+				Inputs.Init(UnitLayers, BatchSize);
+				Measure.Time([&]
+				{
+					for (auto& Input : Inputs)
+					{
+						Checksum += FHierarchicalLayer::MergeLayers(Input).Num();
+					}
+				});
+			}
+
+			Context.ReportOps(TEXT("Grid"), TEXT("MergeLayers"), BatchCount * BatchSize, Measure);
+		}
+
+		{
+			const FHierarchicalLayer Layer{FGameConstants::ChunkSize, 1};
+			const auto Split = Layer.Split(FGameConstants::ChunkSize / 2, 0);
+
+			FChunkBenchmarkMeasure Measure;
+			Measure.Time([&]
+			{
+				for (int32 Op = 0; Op < OpCount; Op++)
+				{
+					Checksum += Split.All().Num();
+				}
+			});
+			Context.ReportOps(TEXT("Grid"), TEXT("SplitAll"), OpCount, Measure);
+		}
+
+		UE_LOG(LogChunkBenchmark, Verbose, TEXT("Grid checksum %llu"), Checksum);
+	}
+
+	FChunkBenchmarkRegistration GGridBenchmark(TEXT("Grid"), &RunGridBenchmark);
+}
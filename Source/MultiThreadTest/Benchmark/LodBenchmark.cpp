@@ -0,0 +1,71 @@
+﻿#include "ChunkBenchmark.h"
+#include "ChunkDataColumn.h"
+#include "ChunkMeshData.h"
+#include "ChunkMesher.h"
+#include "TerrainNoise.h"
+#include "WorldGenerator.h"
+#include "Structs/HierarchicalDownsampler.h"
+
+namespace
+{
+	int32 CountTriangles(const FChunkDataColumn& Column)
+	{
+		auto Mesh = FChunkMeshData::Acquire();
+		int32 Triangles = 0;
+		for (int32 ChunkZ = 0; ChunkZ < Column.ChunkDatas.Num(); ChunkZ++)
+		{
+			Mesh->Reset();
+			FChunkMesher::BuildSection(Column, ChunkZ, *Mesh);
+			Triangles += Mesh->NumTriangles();
+		}
+
+		return Triangles;
+	}
+
+	void RunLodBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 ColumnCount = Context.GetIntParam(TEXT("Columns="), 256);
+		const TArray<FChunkDataColumn> FullColumns =
+			FChunkBenchmarkFixtures::MakeGeneratedColumns(ColumnCount, 16);
+		UWorldGenerator* WorldGenerator = NewObject<UWorldGenerator>();
+		const auto Noise = WorldGenerator->CreateNoise();
+
+		for (uint8 Resolution = FGameConstants::ChunkSize; Resolution >= 1; Resolution /= 2)
+		{
+			// Generated straight at this resolution, what far columns cost the workers
+			double Triangles = 0;
+			double Bytes = 0;
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 ColumnIdx = 0; ColumnIdx < ColumnCount; ColumnIdx++)
+			{
+				FChunkDataColumn Column;
+				WorldGenerator->GenerateColumn(FullColumns[ColumnIdx].ColumnPos, *Noise, Column,
+				                               Resolution);
+				Bytes += Column.GetAllocatedSize();
+				Triangles += CountTriangles(Column);
+			}
+			const double GenerateSeconds = FPlatformTime::Seconds() - StartTime;
+
+			// Built from the full resolution column, what a column loaded from disk costs
+			StartTime = FPlatformTime::Seconds();
+			for (const auto& FullColumn : FullColumns)
+			{
+				FHierarchicalGrid Downsampled;
+				for (const auto& Grid : FullColumn.ChunkDatas)
+				{
+					FHierarchicalDownsampler::Downsample(Grid, Resolution, Downsampled);
+				}
+			}
+			const double DownsampleSeconds = FPlatformTime::Seconds() - StartTime;
+
+			Context.Report(TEXT("LoD"), FString::Printf(TEXT("Resolution %d"), Resolution), {
+				               {TEXT("GenerateAndMeshUsPerColumn"), GenerateSeconds * 1e6 / ColumnCount},
+				               {TEXT("DownsampleUsPerColumn"), DownsampleSeconds * 1e6 / ColumnCount},
+				               {TEXT("BytesPerColumn"), Bytes / ColumnCount},
+				               {TEXT("TrianglesPerColumn"), Triangles / ColumnCount}
+			               });
+		}
+	}
+
+	FChunkBenchmarkRegistration GLodBenchmark(TEXT("LoD"), &RunLodBenchmark);
+}
@@ -0,0 +1,77 @@
+﻿#include "ChunkBenchmark.h"
+#include "Structs/HierarchicalDenseCodec.h"
+
+namespace
+{
+	/**
+	 * Drop the span start masks everywhere, which makes lookups walk the spans like they
+	 * did before the masks existed
+	 */
+	void ClearSpanStarts(FHierarchicalGrid& Grid)
+	{
+		Grid.SpanStarts = 0;
+		for (auto& Layer : Grid.Layers)
+		{
+			Layer.SpanStarts = 0;
+			for (auto& Row : Layer.Rows)
+			{
+				Row.SpanStarts = 0;
+			}
+		}
+	}
+
+	/**
+	 * Worst case for the hierarchy: every layer, row and col is its own span
+	 */
+	FHierarchicalGrid MakeCheckerGrid()
+	{
+		const auto Buffer = FDenseBlockBuffer::Acquire(FGameConstants::ChunkSize);
+		for (int32 Idx = 0; Idx < Buffer->Blocks.Num(); Idx++)
+		{
+			constexpr int32 RowSize = FGameConstants::ChunkSize;
+			constexpr int32 LayerSize = RowSize * RowSize;
+			Buffer->Blocks[Idx] = (Idx + Idx / RowSize + Idx / LayerSize) % 3;
+		}
+
+		FHierarchicalGrid Grid;
+		FHierarchicalDenseCodec::Encode(*Buffer, Grid);
+		return Grid;
+	}
+
+	void RunLookupBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 LookupCount = Context.GetIntParam(TEXT("Lookups="), 1000000);
+
+		FRandomStream Random{42};
+		const TArray<FIntVector> Positions = FChunkBenchmarkFixtures::MakeSectionPositions(Random, LookupCount);
+
+		FRandomStream TerrainRandom{1337};
+		const TPair<const TCHAR*, FHierarchicalGrid> Grids[] = {
+			{TEXT("Checker"), MakeCheckerGrid()},
+			{TEXT("Terrain"), FChunkBenchmarkFixtures::MakeTerrainSection(TerrainRandom)}
+		};
+
+		for (const auto& [Name, Grid] : Grids)
+		{
+			FHierarchicalGrid LinearGrid = Grid;
+			ClearSpanStarts(LinearGrid);
+
+			uint64 LinearChecksum = 0;
+			FChunkBenchmarkMeasure LinearMeasure;
+			FChunkBenchmarkFixtures::TimeLookups(LinearGrid, Positions, LinearMeasure, LinearChecksum);
+
+			uint64 IndexedChecksum = 0;
+			FChunkBenchmarkMeasure IndexedMeasure;
+			FChunkBenchmarkFixtures::TimeLookups(Grid, Positions, IndexedMeasure, IndexedChecksum);
+
+			checkf(LinearChecksum == IndexedChecksum, TEXT("Indexed lookups disagree on %s"), Name);
+
+			Context.ReportOps(TEXT("Lookup"), FString::Printf(TEXT("%s/Linear"), Name), LookupCount,
+			                  LinearMeasure);
+			Context.ReportOps(TEXT("Lookup"), FString::Printf(TEXT("%s/Indexed"), Name), LookupCount,
+			                  IndexedMeasure);
+		}
+	}
+
+	FChunkBenchmarkRegistration GLookupBenchmark(TEXT("Lookup"), &RunLookupBenchmark);
+}
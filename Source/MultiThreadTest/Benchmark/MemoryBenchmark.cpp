@@ -0,0 +1,110 @@
+﻿#include "ChunkBenchmark.h"
+#include "ChunkColumnSnapshot.h"
+#include "ChunkDataColumn.h"
+#include "ChunkMemoryStats.h"
+
+namespace
+{
+	/**
+	 * Number of separate heap blocks behind a column, an array stored inline counts as none
+	 */
+	int32 CountHeapBlocks(const FChunkDataColumn& Column)
+	{
+		int32 Blocks = Column.ChunkDatas.GetAllocatedSize() ? 1 : 0;
+		for (const auto& Grid : Column.ChunkDatas)
+		{
+			Blocks += Grid.Layers.GetAllocatedSize() ? 1 : 0;
+			for (const auto& Layer : Grid.Layers)
+			{
+				Blocks += Layer.Rows.GetAllocatedSize() ? 1 : 0;
+				for (const auto& Row : Layer.Rows)
+				{
+					Blocks += Row.Cols.GetAllocatedSize() ? 1 : 0;
+				}
+			}
+		}
+
+		return Blocks;
+	}
+
+	void ReportMemory(const FChunkBenchmarkContext& Context, const TCHAR* Case,
+	                   const TArray<FChunkDataColumn>& Columns)
+	{
+		FChunkMemoryStats Memory;
+		double Blocks = 0;
+		for (const auto& Column : Columns)
+		{
+			Memory += FChunkMemoryStats::FromColumn(Column);
+			Blocks += CountHeapBlocks(Column);
+		}
+
+		Context.Report(TEXT("Memory"), Case, {
+			               {TEXT("BytesPerColumn"), Memory.GetBytesPerColumn()},
+			               {TEXT("HeapBlocksPerColumn"), Blocks / Columns.Num()},
+			               {TEXT("SpansPerSection"), Memory.GetSpansPerSection()},
+			               {TEXT("CompressionRatio"), Memory.GetCompressionRatio()},
+			               {
+				               TEXT("UniformSectionsPct"),
+				               Memory.Sections ? 100.0 * Memory.UniformSections / Memory.Sections : 0
+			               }
+		               });
+	}
+
+	void RunMemoryBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 ColumnCount = Context.GetIntParam(TEXT("Columns="), 64);
+		ReportMemory(Context, TEXT("Generated"),
+		             FChunkBenchmarkFixtures::MakeGeneratedColumns(ColumnCount, 8));
+
+		FRandomStream Random{7};
+		TArray<FChunkDataColumn> Noisy;
+		for (int32 ColumnIdx = 0; ColumnIdx < ColumnCount; ColumnIdx++)
+		{
+			const FIntVector2 ColumnPos{ColumnIdx % 8, ColumnIdx / 8};
+			Noisy.Add(FChunkBenchmarkFixtures::MakeNoisyColumn(Random, ColumnPos));
+		}
+
+		ReportMemory(Context, TEXT("Noisy"), Noisy);
+
+		// Editing one block of a published column: a deep copy of the column against a fork
+		// of its snapshot, which only copies the edited section
+		{
+			FChunkBenchmarkMeasure Measure;
+			uint64 Checksum = 0;
+			Measure.Time([&]
+			{
+				for (const auto& Column : Generated)
+				{
+					FChunkDataColumn Copy = Column;
+					Copy.ChunkDatas[0].Set(0, 0, 0, 2);
+					Checksum += Copy.ChunkDatas[0].Layers.Num();
+				}
+			});
+			Context.ReportOps(TEXT("Memory"), TEXT("EditByColumnCopy"), Generated.Num(), Measure);
+
+			TArray<TSharedRef<const FChunkColumnSnapshot, ESPMode::ThreadSafe>> Snapshots;
+			for (auto& Column : Generated)
+			{
+				Snapshots.Add(MakeShared<const FChunkColumnSnapshot, ESPMode::ThreadSafe>(
+					MoveTemp(Column)));
+			}
+
+			FChunkBenchmarkMeasure ForkMeasure;
+			ForkMeasure.Time([&]
+			{
+				for (const auto& Snapshot : Snapshots)
+				{
+					const auto Fork = Snapshot->Fork();
+					Fork->EditSection(0).Set(0, 0, 0, 2);
+					Checksum += Fork->GetSection(0).Layers.Num();
+				}
+			});
+			Context.ReportOps(TEXT("Memory"), TEXT("EditBySnapshotFork"), Snapshots.Num(),
+			                  ForkMeasure);
+
+			UE_LOG(LogChunkBenchmark, Verbose, TEXT("Memory checksum %llu"), Checksum);
+		}
+	}
+
+	FChunkBenchmarkRegistration GMemoryBenchmark(TEXT("Memory"), &RunMemoryBenchmark);
+}
@@ -0,0 +1,110 @@
+﻿#include "ChunkBenchmark.h"
+#include "ChunkDataColumn.h"
+#include "ChunkMeshData.h"
+#include "ChunkMesher.h"
+#include "Structs/HierarchicalDenseCodec.h"
+
+namespace
+{
+	/**
+	 * Faces a mesher without any merging would emit: one per block face next to air
+	 */
+	int32 CountExposedFaces(const FChunkDataColumn& Column, const int32 ChunkZ)
+	{
+		const auto Buffer = FDenseBlockBuffer::Acquire(FGameConstants::ChunkSize);
+		FHierarchicalDenseCodec::Decode(Column.ChunkDatas[ChunkZ], *Buffer);
+
+		const auto IsAir = [&Column, &Buffer, ChunkZ](const int32 X, const int32 Y, const int32 Z)
+		{
+			constexpr int32 Size = FGameConstants::ChunkSize;
+			if (X < 0 || Y < 0 || X >= Size || Y >= Size)
+			{
+				return true;
+			}
+
+			if (Z < 0 || Z >= Size)
+			{
+				const int32 NeighborZ = ChunkZ + (Z < 0 ? -1 : 1);
+				return !Column.ChunkDatas.IsValidIndex(NeighborZ) ||
+					Column.ChunkDatas[NeighborZ].Get(X, Y, (Z + Size) % Size) == 0;
+			}
+
+			return Buffer->Get(X, Y, Z) == 0;
+		};
+
+		int32 Faces = 0;
+		for (int32 Z = 0; Z < FGameConstants::ChunkSize; Z++)
+		{
+			for (int32 X = 0; X < FGameConstants::ChunkSize; X++)
+			{
+				for (int32 Y = 0; Y < FGameConstants::ChunkSize; Y++)
+				{
+					if (Buffer->Get(X, Y, Z) == 0)
+					{
+						continue;
+					}
+
+					Faces += IsAir(X - 1, Y, Z) + IsAir(X + 1, Y, Z) + IsAir(X, Y - 1, Z) +
+						IsAir(X, Y + 1, Z) + IsAir(X, Y, Z - 1) + IsAir(X, Y, Z + 1);
+				}
+			}
+		}
+
+		return Faces;
+	}
+
+	void RunColumns(const FChunkBenchmarkContext& Context, const TCHAR* Case,
+	                const TArray<FChunkDataColumn>& Columns)
+	{
+		const int32 Sections = Columns.Num() * FGameConstants::ChunksInZ;
+		auto Mesh = FChunkMeshData::Acquire();
+
+		double Triangles = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (const auto& Column : Columns)
+		{
+			for (int32 ChunkZ = 0; ChunkZ < FGameConstants::ChunksInZ; ChunkZ++)
+			{
+				Mesh->Reset();
+				FChunkMesher::BuildSection(Column, ChunkZ, *Mesh);
+				Triangles += Mesh->NumTriangles();
+			}
+		}
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		double NaiveTriangles = 0;
+		for (const auto& Column : Columns)
+		{
+			for (int32 ChunkZ = 0; ChunkZ < FGameConstants::ChunksInZ; ChunkZ++)
+			{
+				NaiveTriangles += 2 * CountExposedFaces(Column, ChunkZ);
+			}
+		}
+
+		Context.Report(TEXT("Mesh"), Case, {
+			               {TEXT("UsPerSection"), Seconds * 1e6 / Sections},
+			               {TEXT("TrianglesPerSection"), Triangles / Sections},
+			               {TEXT("PerFaceTrianglesPerSection"), NaiveTriangles / Sections}
+		               });
+	}
+
+	void RunMeshBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 ColumnCount = Context.GetIntParam(TEXT("Columns="), 64);
+		RunColumns(Context, TEXT("Generated"),
+		           FChunkBenchmarkFixtures::MakeGeneratedColumns(ColumnCount, 8));
+
+		// Worst case for merging: a checkerboard of two blocks in the lowest section
+		FChunkDataColumn Checker;
+		const auto Buffer = FDenseBlockBuffer::Acquire(FGameConstants::ChunkSize);
+		for (int32 Idx = 0; Idx < Buffer->Blocks.Num(); Idx++)
+		{
+			Buffer->Blocks[Idx] = (Idx + Idx / 16 + Idx / 256) % 2;
+		}
+
+		FHierarchicalDenseCodec::Encode(*Buffer, Checker.ChunkDatas[0]);
+		RunColumns(Context, TEXT("Checker"), {Checker});
+	}
+
+	FChunkBenchmarkRegistration GMeshBenchmark(TEXT("Mesh"), &RunMeshBenchmark);
+}
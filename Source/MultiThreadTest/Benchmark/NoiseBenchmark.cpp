@@ -0,0 +1,87 @@
+﻿#include "ChunkBenchmark.h"
+#include "TerrainNoise.h"
+#include "WorldGenerator.h"
+#include "Async/Async.h"
+#include "Constants/GameConstants.h"
+#include <atomic>
+
+namespace
+{
+	/**
+	 * Every thread samples whole column grids with its own FTerrainNoise, like the workers do
+	 */
+	double RunSampling(const TArray<TUniquePtr<FTerrainNoise>>& Noises, const int32 ThreadCount,
+	                   const int32 ColumnsPerThread)
+	{
+		std::atomic<int32> Ready{0};
+		std::atomic<bool> bGo{false};
+
+		TArray<TFuture<void>> Workers;
+		for (int32 ThreadIdx = 0; ThreadIdx < ThreadCount; ThreadIdx++)
+		{
+			const FTerrainNoise& Noise = *Noises[ThreadIdx];
+			Workers.Add(Async(EAsyncExecution::Thread,
+			                  [&Noise, &Ready, &bGo, ThreadIdx, ColumnsPerThread]
+			                  {
+				                  TStaticArray<float, FGameConstants::ChunkSize * FGameConstants::ChunkSize> Values;
+
+				                  Ready.fetch_add(1);
+				                  while (!bGo.load(std::memory_order_acquire))
+				                  {
+					                  FPlatformProcess::Yield();
+				                  }
+
+				                  for (int32 ColumnIdx = 0; ColumnIdx < ColumnsPerThread; ColumnIdx++)
+				                  {
+					                  const FVector2f Origin{
+						                  static_cast<float>(ColumnIdx * FGameConstants::ChunkSize),
+						                  static_cast<float>(ThreadIdx * FGameConstants::ChunkSize)
+					                  };
+					                  Noise.SampleGrid(Origin, 1.f, FGameConstants::ChunkSize, Values);
+				                  }
+			                  }));
+		}
+
+		while (Ready.load() < ThreadCount)
+		{
+			FPlatformProcess::Yield();
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		bGo.store(true, std::memory_order_release);
+		for (auto& Worker : Workers)
+		{
+			Worker.Wait();
+		}
+
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	void RunNoiseBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 MaxThreads = Context.GetIntParam(TEXT("MaxThreads="),
+		                                             FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+		const int32 ColumnsPerThread = Context.GetIntParam(TEXT("Columns="), 4096);
+		const UWorldGenerator* WorldGenerator = NewObject<UWorldGenerator>();
+
+		// The noise owns a UObject, so it is created here on the game thread
+		TArray<TUniquePtr<FTerrainNoise>> Noises;
+		for (int32 ThreadIdx = 0; ThreadIdx < MaxThreads; ThreadIdx++)
+		{
+			Noises.Add(WorldGenerator->CreateNoise());
+		}
+
+		for (int32 ThreadCount = 1; ThreadCount <= MaxThreads; ThreadCount *= 2)
+		{
+			const double Seconds = RunSampling(Noises, ThreadCount, ColumnsPerThread);
+			const double Samples = static_cast<double>(ThreadCount) * ColumnsPerThread
+				* FGameConstants::ChunkSize * FGameConstants::ChunkSize;
+			Context.Report(TEXT("Noise"), FString::Printf(TEXT("%d threads"), ThreadCount), {
+				               {TEXT("MSamplesPerSec"), Samples / Seconds / 1e6},
+				               {TEXT("MSamplesPerSecPerThread"), Samples / Seconds / 1e6 / ThreadCount}
+			               });
+		}
+	}
+
+	FChunkBenchmarkRegistration GNoiseBenchmark(TEXT("Noise"), &RunNoiseBenchmark);
+}
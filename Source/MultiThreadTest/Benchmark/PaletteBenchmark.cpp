@@ -0,0 +1,80 @@
+﻿#include "ChunkBenchmark.h"
+#include "Structs/PaletteSection.h"
+
+namespace
+{
+	FHierarchicalGrid MakeNoisySection(FRandomStream& Random, const int32 BlockTypes)
+	{
+		const auto Buffer = FDenseBlockBuffer::Acquire(FGameConstants::ChunkSize);
+		for (auto& Block : Buffer->Blocks)
+		{
+			Block = Random.FRand() < 0.7f ? 1 : Random.RandRange(2, BlockTypes);
+		}
+
+		FHierarchicalGrid Grid;
+		FHierarchicalDenseCodec::Encode(*Buffer, Grid);
+		return Grid;
+	}
+
+	template <typename SectionType>
+	double TimeLookups(const TArray<SectionType>& Sections, const TArray<FIntVector>& Positions)
+	{
+		uint64 Checksum = 0;
+		FChunkBenchmarkMeasure Measure;
+		for (const auto& Section : Sections)
+		{
+			FChunkBenchmarkFixtures::TimeLookups(Section, Positions, Measure, Checksum);
+		}
+
+		UE_LOG(LogChunkBenchmark, Verbose, TEXT("Checksum %llu"), Checksum);
+		return Measure.Seconds;
+	}
+
+	void Compare(const FChunkBenchmarkContext& Context, const TCHAR* Case,
+	             const TArray<FHierarchicalGrid>& Grids, const TArray<FIntVector>& Positions)
+	{
+		TArray<FPaletteSection> PaletteSections;
+		double GridBytes = 0;
+		double PaletteBytes = 0;
+		int32 PaletteChosen = 0;
+		for (const auto& Grid : Grids)
+		{
+			const auto& Section = PaletteSections.Add_GetRef(FPaletteSection::FromGrid(Grid));
+			GridBytes += sizeof(FHierarchicalGrid) + Grid.GetAllocatedSize();
+			PaletteBytes += sizeof(FPaletteSection) + Section.GetAllocatedSize();
+			PaletteChosen += ChooseBackend(Grid) == EChunkSectionBackend::Palette ? 1 : 0;
+		}
+
+		const double Lookups = static_cast<double>(Grids.Num()) * Positions.Num();
+		Context.Report(TEXT("Palette"), FString::Printf(TEXT("%s/Hierarchical"), Case), {
+			               {TEXT("BytesPerSection"), GridBytes / Grids.Num()},
+			               {TEXT("NsPerGet"), TimeLookups(Grids, Positions) * 1e9 / Lookups}
+		               });
+		Context.Report(TEXT("Palette"), FString::Printf(TEXT("%s/Palette"), Case), {
+			               {TEXT("BytesPerSection"), PaletteBytes / Grids.Num()},
+			               {TEXT("NsPerGet"), TimeLookups(PaletteSections, Positions) * 1e9 / Lookups},
+			               {TEXT("ChosenRatio"), static_cast<double>(PaletteChosen) / Grids.Num()}
+		               });
+	}
+
+	void RunPaletteBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 SectionCount = Context.GetIntParam(TEXT("Sections="), 256);
+
+		FRandomStream Random{99};
+		const TArray<FIntVector> Positions = FChunkBenchmarkFixtures::MakeSectionPositions(Random, 4096);
+
+		TArray<FHierarchicalGrid> Terrain;
+		TArray<FHierarchicalGrid> Noisy;
+		for (int32 Idx = 0; Idx < SectionCount; Idx++)
+		{
+			Terrain.Add(FChunkBenchmarkFixtures::MakeTerrainSection(Random));
+			Noisy.Add(MakeNoisySection(Random, 6));
+		}
+
+		Compare(Context, TEXT("Terrain"), Terrain, Positions);
+		Compare(Context, TEXT("Noisy"), Noisy, Positions);
+	}
+
+	FChunkBenchmarkRegistration GPaletteBenchmark(TEXT("Palette"), &RunPaletteBenchmark);
+}
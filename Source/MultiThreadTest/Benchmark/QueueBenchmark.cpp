@@ -0,0 +1,137 @@
+﻿#include "ChunkBenchmark.h"
+#include "MpmcQueue.h"
+#include "ThreadSafeQueue.h"
+#include "Async/Async.h"
+#include <atomic>
+
+namespace
+{
+	/**
+	 * The queue the pipeline used before TMpmcQueue, locked the same way the workers did
+	 */
+	struct FLockedQueueAdapter
+	{
+		TThreadSafeQueue<int32> Queue;
+
+		bool Enqueue(const int32 Item)
+		{
+			Queue.Enqueue(Item);
+			return true;
+		}
+
+		bool Dequeue(int32& OutItem)
+		{
+			FScopeLock Lock(&Queue.CriticalSection);
+			if (Queue.IsEmptyWithoutLock())
+			{
+				return false;
+			}
+
+			OutItem = Queue.DequeueSafeWithoutLock().GetValue();
+			return true;
+		}
+	};
+
+	struct FMpmcQueueAdapter
+	{
+		TMpmcQueue<int32> Queue{4096};
+
+		bool Enqueue(const int32 Item)
+		{
+			return Queue.Enqueue(Item);
+		}
+
+		bool Dequeue(int32& OutItem)
+		{
+			return Queue.Dequeue(OutItem);
+		}
+	};
+
+	/**
+	 * Every thread enqueues and then dequeues, so all of them contend on both ends. The
+	 * allocation counters are per thread, each one adds what it allocated to the measure
+	 */
+	template <typename QueueType>
+	FChunkBenchmarkMeasure RunContended(const int32 ThreadCount, const int32 OpsPerThread)
+	{
+		QueueType Queue;
+		std::atomic<int32> Ready{0};
+		std::atomic<bool> bGo{false};
+		std::atomic<uint64> AllocationCount{0};
+		std::atomic<uint64> AllocationBytes{0};
+
+		TArray<TFuture<void>> Workers;
+		for (int32 ThreadIdx = 0; ThreadIdx < ThreadCount; ThreadIdx++)
+		{
+			Workers.Add(Async(EAsyncExecution::Thread, [&, OpsPerThread]
+			{
+				Ready.fetch_add(1);
+				while (!bGo.load(std::memory_order_acquire))
+				{
+					FPlatformProcess::Yield();
+				}
+
+				const FChunkBenchmarkAllocations StartAllocations = FChunkBenchmarkAllocations::Get();
+				int32 Item;
+				for (int32 Op = 0; Op < OpsPerThread; Op++)
+				{
+					while (!Queue.Enqueue(Op))
+					{
+						FPlatformProcess::Yield();
+					}
+
+					Queue.Dequeue(Item);
+				}
+
+				const FChunkBenchmarkAllocations Made = FChunkBenchmarkAllocations::Get() - StartAllocations;
+				AllocationCount.fetch_add(Made.Count, std::memory_order_relaxed);
+				AllocationBytes.fetch_add(Made.Bytes, std::memory_order_relaxed);
+			}));
+		}
+
+		while (Ready.load() < ThreadCount)
+		{
+			FPlatformProcess::Yield();
+		}
+
+		FChunkBenchmarkMeasure Measure;
+		Measure.Time([&Workers, &bGo]
+		{
+			bGo.store(true, std::memory_order_release);
+			for (auto& Worker : Workers)
+			{
+				Worker.Wait();
+			}
+		});
+
+		Measure.Allocations.Count += AllocationCount.load();
+		Measure.Allocations.Bytes += AllocationBytes.load();
+		return Measure;
+	}
+
+	void ReportRun(const FChunkBenchmarkContext& Context, const TCHAR* QueueName,
+	               const int32 ThreadCount, const int32 OpsPerThread,
+	               const FChunkBenchmarkMeasure& Measure)
+	{
+		// One enqueue and one dequeue per iteration
+		const int64 TotalOps = 2ll * ThreadCount * OpsPerThread;
+		Context.ReportOps(TEXT("Queue"), FString::Printf(TEXT("%s/%d threads"), QueueName, ThreadCount),
+		                  TotalOps, Measure);
+	}
+
+	void RunQueueBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 MaxThreads = Context.GetIntParam(TEXT("MaxThreads="), 64);
+		const int32 OpsPerThread = Context.GetIntParam(TEXT("Ops="), 100000);
+
+		for (int32 ThreadCount = 1; ThreadCount <= MaxThreads; ThreadCount *= 2)
+		{
+			ReportRun(Context, TEXT("Locked"), ThreadCount, OpsPerThread,
+			          RunContended<FLockedQueueAdapter>(ThreadCount, OpsPerThread));
+			ReportRun(Context, TEXT("Mpmc"), ThreadCount, OpsPerThread,
+			          RunContended<FMpmcQueueAdapter>(ThreadCount, OpsPerThread));
+		}
+	}
+
+	FChunkBenchmarkRegistration GQueueBenchmark(TEXT("Queue"), &RunQueueBenchmark);
+}
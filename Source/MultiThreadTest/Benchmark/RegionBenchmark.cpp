@@ -0,0 +1,86 @@
+﻿#include "ChunkBenchmark.h"
+#include "ChunkDataColumn.h"
+#include "RegionStore.h"
+#include "TerrainNoise.h"
+#include "WorldGenerator.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	/**
+	 * Load every column the way FLoadChunkRunnable does: from the store, or generate and save
+	 */
+	double LoadColumns(FRegionStore& Store, UWorldGenerator* WorldGenerator,
+	                   const FTerrainNoise& Noise, const int32 ColumnCount, int32& OutGenerated)
+	{
+		OutGenerated = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 ColumnIdx = 0; ColumnIdx < ColumnCount; ColumnIdx++)
+		{
+			const FIntVector2 ColumnPos{ColumnIdx % 64, ColumnIdx / 64};
+			FChunkDataColumn ColumnData{ColumnPos};
+			if (!Store.Load(ColumnPos, ColumnData))
+			{
+				WorldGenerator->GenerateColumn(ColumnPos, Noise, ColumnData);
+				Store.Save(ColumnData);
+				OutGenerated++;
+			}
+		}
+
+		return FPlatformTime::Seconds() - StartTime;
+	}
+
+	void RunRegionBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 ColumnCount = Context.GetIntParam(TEXT("Columns="), 1024);
+		UWorldGenerator* WorldGenerator = NewObject<UWorldGenerator>();
+		const auto Noise = WorldGenerator->CreateNoise();
+
+		const FString Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("RegionBenchmark"));
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+		int32 Generated;
+		{
+			// Nothing on disk yet: every column is generated, compressed and kept for the flush
+			FRegionStore Store{Directory, WorldGenerator->GetSettingsHash()};
+			Context.ReportColumns(TEXT("Region"), TEXT("ColdStart"), ColumnCount,
+			                      LoadColumns(Store, WorldGenerator, *Noise, ColumnCount, Generated));
+
+			const double StartTime = FPlatformTime::Seconds();
+			const int32 Files = Store.Flush();
+			Context.Report(TEXT("Region"), TEXT("Flush"), {
+				               {TEXT("Files"), static_cast<double>(Files)},
+				               {TEXT("Ms"), (FPlatformTime::Seconds() - StartTime) * 1e3}
+			               });
+		}
+
+		{
+			// A new session over the same files: every column is a page fault plus a decode
+			FRegionStore Store{Directory, WorldGenerator->GetSettingsHash()};
+			Context.ReportColumns(TEXT("Region"), TEXT("WarmStart"), ColumnCount,
+			                      LoadColumns(Store, WorldGenerator, *Noise, ColumnCount, Generated));
+			ensureMsgf(Generated == 0, TEXT("%d columns were missing from the store"), Generated);
+
+			// Same again with the files already mapped and in the page cache
+			Context.ReportColumns(TEXT("Region"), TEXT("WarmStartMapped"), ColumnCount,
+			                      LoadColumns(Store, WorldGenerator, *Noise, ColumnCount, Generated));
+		}
+
+		TArray<FString> Files;
+		IFileManager::Get().FindFiles(Files, *FPaths::Combine(Directory, TEXT("*.region")), true, false);
+		int64 Bytes = 0;
+		for (const auto& File : Files)
+		{
+			Bytes += IFileManager::Get().FileSize(*FPaths::Combine(Directory, File));
+		}
+
+		Context.Report(TEXT("Region"), TEXT("Disk"), {
+			               {TEXT("BytesPerColumn"), static_cast<double>(Bytes) / ColumnCount}
+		               });
+
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	}
+
+	FChunkBenchmarkRegistration GRegionBenchmark(TEXT("Region"), &RunRegionBenchmark);
+}
@@ -0,0 +1,160 @@
+﻿#include "ChunkBenchmark.h"
+#include "ChunkRegistry.h"
+#include "Async/Async.h"
+#include <atomic>
+
+namespace
+{
+	FIntVector2 ColumnAt(const int32 Idx, const int32 Side)
+	{
+		return FIntVector2{Idx % Side - Side / 2, Idx / Side - Side / 2};
+	}
+
+	/**
+	 * ReaderCount threads look up the neighbors of random registered columns, like the workers
+	 * meshing, while one thread keeps changing states and republishing columns, like the
+	 * game thread and the workers do
+	 */
+	void RunConcurrent(FChunkBenchmarkContext& Context, UChunkRegistry& Registry,
+	                   const int32 ReaderCount, const int32 ColumnCount, const int32 Side,
+	                   const int32 LookupsPerThread)
+	{
+		std::atomic<int32> Ready{0};
+		std::atomic<bool> bGo{false};
+		std::atomic<bool> bReadersDone{false};
+		std::atomic<int64> Writes{0};
+
+		TArray<TFuture<void>> Readers;
+		for (int32 ThreadIdx = 0; ThreadIdx < ReaderCount; ThreadIdx++)
+		{
+			Readers.Add(Async(EAsyncExecution::Thread,
+			                  [&Registry, &Ready, &bGo, ThreadIdx, ColumnCount, Side, LookupsPerThread]
+			                  {
+				                  FRandomStream Random{ThreadIdx};
+				                  FColumnDataPtr Neighbors[4];
+
+				                  Ready.fetch_add(1);
+				                  while (!bGo.load(std::memory_order_acquire))
+				                  {
+					                  FPlatformProcess::Yield();
+				                  }
+
+				                  for (int32 Lookup = 0; Lookup < LookupsPerThread; Lookup++)
+				                  {
+					                  const int32 Idx = Random.RandRange(0, ColumnCount - 1);
+					                  Registry.FindNeighbors(ColumnAt(Idx, Side), Neighbors);
+				                  }
+			                  }));
+		}
+
+		TFuture<void> Writer = Async(EAsyncExecution::Thread,
+		                             [&Registry, &Ready, &bGo, &bReadersDone, &Writes, ColumnCount, Side]
+		                             {
+			                             FRandomStream Random{-1};
+
+			                             Ready.fetch_add(1);
+			                             while (!bGo.load(std::memory_order_acquire))
+			                             {
+				                             FPlatformProcess::Yield();
+			                             }
+
+			                             int64 Count = 0;
+			                             while (!bReadersDone.load(std::memory_order_relaxed))
+			                             {
+				                             const int32 Idx = Random.RandRange(0, ColumnCount - 1);
+				                             const FIntVector2 ColumnPos = ColumnAt(Idx, Side);
+				                             if (Count % 16 == 0)
+				                             {
+					                             Registry.Register(FChunkDataColumn{ColumnPos});
+				                             }
+				                             else
+				                             {
+					                             Registry.SetState(ColumnPos, EColumnState::Meshed);
+				                             }
+
+				                             Count++;
+			                             }
+
+			                             Writes.store(Count);
+		                             });
+
+		while (Ready.load() < ReaderCount + 1)
+		{
+			FPlatformProcess::Yield();
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		bGo.store(true, std::memory_order_release);
+		for (auto& Reader : Readers)
+		{
+			Reader.Wait();
+		}
+
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+		bReadersDone.store(true);
+		Writer.Wait();
+
+		// Four lookups per FindNeighbors
+		const double Lookups = 4.0 * ReaderCount * LookupsPerThread;
+		Context.Report(TEXT("Registry"), FString::Printf(TEXT("Neighbors/%d readers"), ReaderCount), {
+			               {TEXT("MLookupsPerSec"), Lookups / Seconds / 1e6},
+			               {TEXT("NsPerLookup"), Seconds * 1e9 * ReaderCount / Lookups},
+			               {TEXT("WriterMOpsPerSec"), Writes.load() / Seconds / 1e6}
+		               });
+	}
+
+	void RunRegistryBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 Side = Context.GetIntParam(TEXT("Side="), 64);
+		const int32 LookupCount = Context.GetIntParam(TEXT("Lookups="), 1000000);
+		const int32 MaxThreads = Context.GetIntParam(TEXT("MaxThreads="),
+		                                             FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+		const int32 ColumnCount = Side * Side;
+
+		UChunkRegistry* Registry = NewObject<UChunkRegistry>();
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Idx = 0; Idx < ColumnCount; Idx++)
+		{
+			Registry->Add(ColumnAt(Idx, Side));
+		}
+
+		double Seconds = FPlatformTime::Seconds() - StartTime;
+		Context.Report(TEXT("Registry"), TEXT("Add"), {
+			               {TEXT("NsPerOp"), Seconds * 1e9 / ColumnCount}
+		               });
+
+		// Empty columns, so this is the registry and the shared pointer, not the copy of blocks
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Idx = 0; Idx < ColumnCount; Idx++)
+		{
+			Registry->Register(FChunkDataColumn{ColumnAt(Idx, Side)});
+		}
+
+		Seconds = FPlatformTime::Seconds() - StartTime;
+		Context.Report(TEXT("Registry"), TEXT("Register"), {
+			               {TEXT("NsPerOp"), Seconds * 1e9 / ColumnCount}
+		               });
+
+		FRandomStream Random{42};
+		int32 Found = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Lookup = 0; Lookup < LookupCount; Lookup++)
+		{
+			Found += Registry->FindData(ColumnAt(Random.RandRange(0, ColumnCount - 1), Side)).IsValid();
+		}
+
+		Seconds = FPlatformTime::Seconds() - StartTime;
+		checkf(Found == LookupCount, TEXT("%d registered columns were not found"), LookupCount - Found);
+		Context.Report(TEXT("Registry"), TEXT("FindData"), {
+			               {TEXT("NsPerOp"), Seconds * 1e9 / LookupCount}
+		               });
+
+		for (int32 ReaderCount = 1; ReaderCount <= MaxThreads; ReaderCount *= 2)
+		{
+			RunConcurrent(Context, *Registry, ReaderCount, ColumnCount, Side, LookupCount / 4);
+		}
+	}
+
+	FChunkBenchmarkRegistration GRegistryBenchmark(TEXT("Registry"), &RunRegistryBenchmark);
+}
@@ -0,0 +1,132 @@
+﻿#include "ChunkBenchmark.h"
+#include "ChunkDataColumn.h"
+#include "ColumnJob.h"
+#include "LoadChunkRunnable.h"
+#include "MpmcQueue.h"
+#include "WorldGenerator.h"
+#include "Constants/GameConstants.h"
+
+namespace
+{
+	/**
+	 * Columns are laid out in rows of this many, so a column position gives back its index
+	 */
+	constexpr int32 RowLength = 1024;
+
+	double Percentile(const TArray<double>& Sorted, const double Fraction)
+	{
+		const int32 Idx = FMath::Clamp(FMath::CeilToInt(Fraction * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Idx];
+	}
+
+	/**
+	 * Generate ColumnCount columns with WorkerCount real workers, fed like ATest does: the
+	 * job queue is kept LoadQueueDepthPerWorker deep per worker and the results are drained
+	 * as they come. Latency is from the dispatch to the drain
+	 */
+	void RunWorkers(FChunkBenchmarkContext& Context, UWorldGenerator* WorldGenerator,
+	                const int32 WorkerCount, const int32 ColumnCount)
+	{
+		const auto JobQueue = MakeShared<TMpmcQueue<FColumnJob>>();
+		const auto CreateColumnQueue = MakeShared<TMpmcQueue<FChunkDataColumn>>();
+		const auto Workers = FLoadChunkRunnable::Create(WorldGenerator, JobQueue, nullptr,
+		                                                CreateColumnQueue, nullptr, nullptr, nullptr,
+		                                                WorkerCount);
+
+		TArray<uint64> DispatchCycles;
+		DispatchCycles.SetNumZeroed(ColumnCount);
+		TArray<double> Latencies;
+		Latencies.Reserve(ColumnCount);
+
+		const int32 TargetDepth = WorkerCount * FGameConstants::LoadQueueDepthPerWorker;
+		int32 Dispatched = 0;
+
+		const double StartTime = FPlatformTime::Seconds();
+
+		while (Latencies.Num() < ColumnCount)
+		{
+			while (Dispatched < ColumnCount && JobQueue->Num() < TargetDepth)
+			{
+				FColumnJob Job;
+				Job.ColumnPos = FIntVector2{Dispatched % RowLength, Dispatched / RowLength};
+				Job.EnqueueCycles = FPlatformTime::Cycles64();
+				if (!JobQueue->Enqueue(Job))
+				{
+					break;
+				}
+
+				DispatchCycles[Dispatched++] = Job.EnqueueCycles;
+			}
+
+			bool bDrained = false;
+			while (TOptional<FChunkDataColumn> Column = CreateColumnQueue->Dequeue())
+			{
+				const int32 Idx = Column->ColumnPos.Y * RowLength + Column->ColumnPos.X;
+				Latencies.Add(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - DispatchCycles[Idx]));
+				bDrained = true;
+			}
+
+			if (!bDrained)
+			{
+				FPlatformProcess::Yield();
+			}
+		}
+
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		for (const auto Runnable : Workers.Runnables)
+		{
+			Runnable->Stop();
+		}
+
+		uint64 BusyCycles = 0;
+		uint64 QueueWaitCycles = 0;
+		uint64 Jobs = 0;
+		for (int32 WorkerIdx = 0; WorkerIdx < WorkerCount; WorkerIdx++)
+		{
+			Workers.Threads[WorkerIdx]->Kill(true);
+			delete Workers.Threads[WorkerIdx];
+
+			const FLoadChunkWorkerStats& Stats = Workers.Runnables[WorkerIdx]->GetStats();
+			BusyCycles += Stats.BusyCycles.load();
+			QueueWaitCycles += Stats.QueueWaitCycles.load();
+			Jobs += Stats.Jobs.load();
+			delete Workers.Runnables[WorkerIdx];
+		}
+
+		// CPU used by the pool: busy time over wall time, in cores and per worker. A worker
+		// preempted while busy still counts, so past the core count this reads high
+		const double BusySeconds = FPlatformTime::ToSeconds64(BusyCycles);
+		const double QueueWaitSeconds = FPlatformTime::ToSeconds64(QueueWaitCycles);
+
+		Latencies.Sort();
+		Context.Report(TEXT("Scaling"), FString::Printf(TEXT("%d workers"), WorkerCount), {
+			               {TEXT("Workers"), static_cast<double>(WorkerCount)},
+			               {TEXT("ColumnsPerSec"), ColumnCount / Seconds},
+			               {TEXT("LatencyP50Ms"), Percentile(Latencies, 0.5) * 1e3},
+			               {TEXT("LatencyP90Ms"), Percentile(Latencies, 0.9) * 1e3},
+			               {TEXT("LatencyP99Ms"), Percentile(Latencies, 0.99) * 1e3},
+			               {TEXT("QueueWaitMs"), QueueWaitSeconds * 1e3 / FMath::Max<uint64>(Jobs, 1)},
+			               {TEXT("BusyCores"), BusySeconds / Seconds},
+			               {TEXT("WorkerBusyPct"), BusySeconds * 100 / (Seconds * WorkerCount)}
+		               });
+	}
+
+	void RunScalingBenchmark(FChunkBenchmarkContext& Context)
+	{
+		const int32 ColumnCount = Context.GetIntParam(TEXT("Columns="), 2048);
+		const int32 MaxWorkers = Context.GetIntParam(TEXT("MaxThreads="),
+		                                             FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+		UWorldGenerator* WorldGenerator = NewObject<UWorldGenerator>();
+
+		// Powers of two, then the machine's own count so the last point is the real one
+		for (int32 WorkerCount = 1; WorkerCount < MaxWorkers; WorkerCount *= 2)
+		{
+			RunWorkers(Context, WorldGenerator, WorkerCount, ColumnCount);
+		}
+
+		RunWorkers(Context, WorldGenerator, MaxWorkers, ColumnCount);
+	}
+
+	FChunkBenchmarkRegistration GScalingBenchmark(TEXT("Scaling"), &RunScalingBenchmark);
+}
@@ -0,0 +1,155 @@
+﻿#include "ChunkBenchmark.h"
+#include "ChunkColumnCodec.h"
+#include "ChunkDataColumn.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Structs/HierarchicalGridCodec.h"
+
+namespace
+{
+	/**
+	 * Encode then decode every column, with the time and size of each direction
+	 */
+	template <typename EncodeType, typename DecodeType>
+	void RunCase(const FChunkBenchmarkContext& Context, const FString& Case,
+	             const TArray<FChunkDataColumn>& Columns, EncodeType&& Encode, DecodeType&& Decode)
+	{
+		TArray<TArray<uint8>> Encoded;
+		Encoded.SetNum(Columns.Num());
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 ColumnIdx = 0; ColumnIdx < Columns.Num(); ColumnIdx++)
+		{
+			Encode(Columns[ColumnIdx], Encoded[ColumnIdx]);
+		}
+		const double EncodeSeconds = FPlatformTime::Seconds() - StartTime;
+
+		// Decode into the same column over and over, like a worker reusing its output
+		FChunkDataColumn Decoded;
+		int32 Failures = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (int32 ColumnIdx = 0; ColumnIdx < Columns.Num(); ColumnIdx++)
+		{
+			Failures += Decode(Encoded[ColumnIdx], Decoded) ? 0 : 1;
+		}
+		const double DecodeSeconds = FPlatformTime::Seconds() - StartTime;
+
+		ensureMsgf(Failures == 0, TEXT("%s: %d columns failed to decode"), *Case, Failures);
+
+		double Bytes = 0;
+		for (const auto& Data : Encoded)
+		{
+			Bytes += Data.Num();
+		}
+
+		Context.Report(TEXT("Serializer"), Case, {
+			               {TEXT("BytesPerColumn"), Bytes / Columns.Num()},
+			               {TEXT("EncodeColumnsPerSec"), Columns.Num() / EncodeSeconds},
+			               {TEXT("DecodeColumnsPerSec"), Columns.Num() / DecodeSeconds}
+		               });
+	}
+
+	void RunColumns(const FChunkBenchmarkContext& Context, const TCHAR* Name,
+	                const TArray<FChunkDataColumn>& Columns)
+	{
+		RunCase(Context, FString::Printf(TEXT("%s/Archive"), Name), Columns,
+		        [](const FChunkDataColumn& Column, TArray<uint8>& Out)
+		        {
+			        FMemoryWriter Writer(Out);
+			        Writer << const_cast<FChunkDataColumn&>(Column);
+		        },
+		        [](const TArray<uint8>& Data, FChunkDataColumn& OutColumn)
+		        {
+			        FMemoryReader Reader(Data);
+			        Reader << OutColumn;
+			        return !Reader.IsError();
+		        });
+
+		for (const auto Compression : {
+			     EColumnCompression::None, EColumnCompression::LZ4, EColumnCompression::Oodle
+		     })
+		{
+			const FName Format = FChunkColumnCodec::GetFormatName(Compression);
+			RunCase(Context, FString::Printf(TEXT("%s/Codec%s"), Name,
+			                                 Format.IsNone() ? TEXT("") : *Format.ToString()),
+			        Columns,
+			        [Compression](const FChunkDataColumn& Column, TArray<uint8>& Out)
+			        {
+				        FChunkColumnCodec::Encode(Column, Out, Compression);
+			        },
+			        [](const TArray<uint8>& Data, FChunkDataColumn& OutColumn)
+			        {
+				        return FChunkColumnCodec::Decode(Data, OutColumn);
+			        });
+		}
+
+		// Straight into a pooled dense buffer, e.g. for meshing, without building the grids
+		const auto Buffer = FDenseBlockBuffer::Acquire(FGameConstants::ChunkSize);
+		RunCase(Context, FString::Printf(TEXT("%s/GridToDense"), Name), Columns,
+		        [](const FChunkDataColumn& Column, TArray<uint8>& Out)
+		        {
+			        for (const auto& Grid : Column.ChunkDatas)
+			        {
+				        FHierarchicalGridCodec::Encode(Grid, Out);
+			        }
+		        },
+		        [&Buffer](const TArray<uint8>& Data, FChunkDataColumn&)
+		        {
+			        FHierarchicalGridCodec::FReader Reader{Data};
+			        bool bSuccess = true;
+			        for (int32 ChunkZ = 0; ChunkZ < FGameConstants::ChunksInZ; ChunkZ++)
+			        {
+				        bSuccess &= FHierarchicalGridCodec::Decode(Reader, *Buffer);
+			        }
+
+			        return bSuccess;
+		        });
+	}
+
+	/**
+	 * Columns written with fewer sections than ChunksInZ decode padded with air, and a raw
+	 * size no column can have is rejected before anything is allocated for it
+	 */
+	void CheckMalformedColumns()
+	{
+		FChunkDataColumn Short{FIntVector2{3, -2}};
+		Short.ChunkDatas.SetNum(2);
+		Short.ChunkDatas[0] = FHierarchicalGrid{1u};
+
+		TArray<uint8> Data;
+		FChunkColumnCodec::Encode(Short, Data, EColumnCompression::None);
+
+		FChunkDataColumn Decoded;
+		const bool bShortDecoded = FChunkColumnCodec::Decode(Data, Decoded);
+		ensureMsgf(bShortDecoded && Decoded.ColumnPos == Short.ColumnPos &&
+		           Decoded.ChunkDatas.Num() == FGameConstants::ChunksInZ &&
+		           Decoded.ChunkDatas[0].Get(0, 0, 0) == 1 &&
+		           Decoded.ChunkDatas.Last().Get(0, 0, 0) == 0,
+		           TEXT("A column with 2 sections didn't decode padded with air"));
+
+		TArray<uint8> Oversized{FChunkColumnCodec::Version, static_cast<uint8>(EColumnCompression::LZ4)};
+		FHierarchicalGridCodec::WriteVarint(Oversized, MAX_uint32);
+		ensureMsgf(!FChunkColumnCodec::Decode(Oversized, Decoded),
+		           TEXT("A column claiming a %u bytes payload decoded"), MAX_uint32);
+	}
+
+	void RunSerializerBenchmark(FChunkBenchmarkContext& Context)
+	{
+		CheckMalformedColumns();
+
+		const int32 ColumnCount = Context.GetIntParam(TEXT("Columns="), 256);
+		const TArray<FChunkDataColumn> Generated =
+			FChunkBenchmarkFixtures::MakeGeneratedColumns(ColumnCount, 16);
+		TArray<FChunkDataColumn> Noisy;
+		FRandomStream Random{7};
+		for (const auto& Column : Generated)
+		{
+			Noisy.Add(FChunkBenchmarkFixtures::MakeNoisyColumn(Random, Column.ColumnPos));
+		}
+
+		RunColumns(Context, TEXT("Generated"), Generated);
+		RunColumns(Context, TEXT("Noisy"), Noisy);
+	}
+
+	FChunkBenchmarkRegistration GSerializerBenchmark(TEXT("Serializer"), &RunSerializerBenchmark);
+}
@@ -0,0 +1,143 @@
+﻿#include "ChunkColumnCodec.h"
+
+#include "ChunkDataColumn.h"
+#include "Misc/Compression.h"
+#include "Structs/HierarchicalGridCodec.h"
+
+namespace
+{
+	/**
+	 * Largest uncompressed payload: the position, the section count and every section at its
+	 * largest. Compressed payloads claiming more are rejected before allocating for them
+	 */
+	constexpr uint32 MaxRawSize = 3 * FHierarchicalGridCodec::MaxVarintSize +
+		FGameConstants::ChunksInZ * FHierarchicalGridCodec::MaxEncodedSize;
+
+	uint32 ZigZag(const int32 Value)
+	{
+		return (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+	}
+
+	int32 UnZigZag(const uint32 Value)
+	{
+		return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1);
+	}
+
+	void EncodeRaw(const FChunkDataColumn& Column, TArray<uint8>& Out)
+	{
+		FHierarchicalGridCodec::WriteVarint(Out, ZigZag(Column.ColumnPos.X));
+		FHierarchicalGridCodec::WriteVarint(Out, ZigZag(Column.ColumnPos.Y));
+		FHierarchicalGridCodec::WriteVarint(Out, Column.ChunkDatas.Num());
+		for (const auto& Grid : Column.ChunkDatas)
+		{
+			FHierarchicalGridCodec::Encode(Grid, Out);
+		}
+	}
+}
+
+void FChunkColumnCodec::Encode(const FChunkDataColumn& Column, TArray<uint8>& Out,
+                               const EColumnCompression Compression)
+{
+	Out.Add(Version);
+	Out.Add(static_cast<uint8>(Compression));
+
+	if (Compression == EColumnCompression::None)
+	{
+		EncodeRaw(Column, Out);
+		return;
+	}
+
+	static thread_local TArray<uint8> Raw;
+	Raw.Reset();
+	EncodeRaw(Column, Raw);
+
+	const FName Format = GetFormatName(Compression);
+	const int32 HeaderEnd = Out.Num();
+	int32 CompressedSize = FCompression::CompressMemoryBound(Format, Raw.Num());
+
+	FHierarchicalGridCodec::WriteVarint(Out, Raw.Num());
+	const int32 PayloadStart = Out.Num();
+	Out.AddUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(Format, Out.GetData() + PayloadStart, CompressedSize,
+	                                  Raw.GetData(), Raw.Num()))
+	{
+		// Store it raw rather than failing the save
+		Out.SetNum(HeaderEnd);
+		Out[HeaderEnd - 1] = static_cast<uint8>(EColumnCompression::None);
+		Out.Append(Raw);
+		return;
+	}
+
+	Out.SetNum(PayloadStart + CompressedSize);
+}
+
+bool FChunkColumnCodec::Decode(const TConstArrayView<uint8> Data, FChunkDataColumn& OutColumn)
+{
+	if (Data.Num() < 2 || Data[0] == 0 || Data[0] > Version)
+	{
+		return false;
+	}
+
+	const auto Compression = static_cast<EColumnCompression>(Data[1]);
+	FHierarchicalGridCodec::FReader Reader{Data.GetData() + 2, Data.Num() - 2};
+
+	static thread_local TArray<uint8> Raw;
+	if (Compression != EColumnCompression::None)
+	{
+		const uint32 RawSize = Reader.ReadVarint();
+		if (Reader.bError || Compression > EColumnCompression::Oodle || RawSize > MaxRawSize)
+		{
+			return false;
+		}
+
+		Raw.SetNumUninitialized(RawSize);
+		if (!FCompression::UncompressMemory(GetFormatName(Compression), Raw.GetData(), RawSize,
+		                                    Reader.Ptr, Reader.End - Reader.Ptr))
+		{
+			return false;
+		}
+
+		Reader = FHierarchicalGridCodec::FReader{Raw};
+	}
+
+	OutColumn.ColumnPos.X = UnZigZag(Reader.ReadVarint());
+	OutColumn.ColumnPos.Y = UnZigZag(Reader.ReadVarint());
+
+	const uint32 SectionCount = Reader.ReadVarint();
+	if (Reader.bError || SectionCount > FGameConstants::ChunksInZ)
+	{
+		return false;
+	}
+
+	OutColumn.ChunkDatas.SetNum(FGameConstants::ChunksInZ);
+	for (uint32 ChunkZ = 0; ChunkZ < SectionCount; ChunkZ++)
+	{
+		if (!FHierarchicalGridCodec::Decode(Reader, OutColumn.ChunkDatas[ChunkZ]))
+		{
+			return false;
+		}
+	}
+
+	// Everything consumes ChunksInZ sections, the ones above what was written are air
+	const uint8 Resolution = SectionCount ? OutColumn.ChunkDatas[0].Resolution : FGameConstants::ChunkSize;
+	for (int32 ChunkZ = SectionCount; ChunkZ < FGameConstants::ChunksInZ; ChunkZ++)
+	{
+		OutColumn.ChunkDatas[ChunkZ] = FHierarchicalGrid{0u, Resolution};
+	}
+
+	OutColumn.RebuildHeights();
+	return true;
+}
+
+FName FChunkColumnCodec::GetFormatName(const EColumnCompression Compression)
+{
+	switch (Compression)
+	{
+	case EColumnCompression::LZ4:
+		return NAME_LZ4;
+	case EColumnCompression::Oodle:
+		return NAME_Oodle;
+	default:
+		return NAME_None;
+	}
+}
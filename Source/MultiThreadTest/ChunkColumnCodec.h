@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+struct FChunkDataColumn;
+
+enum class EColumnCompression : uint8
+{
+	None,
+	LZ4,
+	Oodle,
+};
+
+/**
+ * Compact encoding of a whole column: a small header, then the column position and every
+ * section as FHierarchicalGridCodec, optionally compressed as a whole.
+ *
+ * Decoding reuses the sections already in the column and a per thread scratch buffer for
+ * decompression, so a warm worker decodes without allocating.
+ */
+struct FChunkColumnCodec
+{
+	static constexpr uint8 Version = 1;
+
+	/**
+	 * Append the encoded column to Out
+	 */
+	static void Encode(const FChunkDataColumn& Column, TArray<uint8>& Out,
+	                   EColumnCompression Compression = EColumnCompression::LZ4);
+
+	/**
+	 * Always fills ChunksInZ sections, the ones missing from Data are uniform air
+	 */
+	static bool Decode(TConstArrayView<uint8> Data, FChunkDataColumn& OutColumn);
+
+	static FName GetFormatName(EColumnCompression Compression);
+};
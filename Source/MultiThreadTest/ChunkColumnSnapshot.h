@@ -0,0 +1,142 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkCopyCounters.h"
+#include "ChunkDataColumn.h"
+
+/**
+ * Immutable version of a column, shared by every reader on any thread (registry, meshers,
+ * and later savers) without copying.
+ *
+ * Each mixed section lives in its own reference counted block, shared by every snapshot
+ * holding it, uniform ones (see ESectionTag) are stored inline and own nothing. An edit
+ * forks the snapshot, which only copies the section pointers, and EditSection copies a
+ * section the first time it is written if another snapshot still holds it: an edit of one
+ * section costs one section, whatever the size of the column.
+ *
+ * A snapshot is only written before it is published, readers always get a const one.
+ */
+struct FChunkColumnSnapshot
+{
+	/**
+	 * Moves the sections of the column in, nothing is copied
+	 */
+	explicit FChunkColumnSnapshot(FChunkDataColumn&& Column) : ColumnPos(Column.ColumnPos),
+	                                                           Heights(Column.Heights)
+	{
+		Sections.Reserve(Column.ChunkDatas.Num());
+		for (auto& Grid : Column.ChunkDatas)
+		{
+			FSection& Section = Sections.AddDefaulted_GetRef();
+			if (Grid.IsUniform())
+			{
+				Section.Uniform = MoveTemp(Grid);
+			}
+			else
+			{
+				Section.Mixed = MakeShared<FHierarchicalGrid, ESPMode::ThreadSafe>(MoveTemp(Grid));
+			}
+		}
+	}
+
+	FIntVector2 ColumnPos;
+
+	/**
+	 * See FChunkDataColumn::Heights, rebuilt by the registry after an edit
+	 */
+	FColumnHeights Heights;
+
+	void RebuildHeights()
+	{
+		Heights = FColumnHeights::FromSections(*this);
+	}
+
+	int32 NumSections() const
+	{
+		return Sections.Num();
+	}
+
+	const FHierarchicalGrid& GetSection(const int32 ChunkZ) const
+	{
+		return Sections[ChunkZ].Get();
+	}
+
+	uint8 GetResolution() const
+	{
+		return Sections.Num() ? Sections[0].Get().Resolution : FGameConstants::ChunkSize;
+	}
+
+	/**
+	 * New version of the column sharing every section with this one
+	 */
+	TSharedRef<FChunkColumnSnapshot, ESPMode::ThreadSafe> Fork() const
+	{
+		return MakeShared<FChunkColumnSnapshot, ESPMode::ThreadSafe>(*this);
+	}
+
+	/**
+	 * The section to write, copied first if another snapshot holds it too
+	 */
+	FHierarchicalGrid& EditSection(const int32 ChunkZ)
+	{
+		FSection& Section = Sections[ChunkZ];
+
+		// Inline, it's this snapshot's own. It may not stay uniform, so it gets a block
+		if (!Section.Mixed)
+		{
+			Section.Mixed = MakeShared<FHierarchicalGrid, ESPMode::ThreadSafe>(
+				MoveTemp(Section.Uniform));
+			return *Section.Mixed;
+		}
+
+		// Only snapshots hold sections, a single reference is this one
+		if (Section.Mixed.GetSharedReferenceCount() > 1)
+		{
+			Section.Mixed = MakeShared<FHierarchicalGrid, ESPMode::ThreadSafe>(*Section.Mixed);
+			FChunkCopyCounters::SectionCopies.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return *Section.Mixed;
+	}
+
+	bool SharesSection(const FChunkColumnSnapshot& Other, const int32 ChunkZ) const
+	{
+		return Sections[ChunkZ].Mixed && Sections[ChunkZ].Mixed == Other.Sections[ChunkZ].Mixed;
+	}
+
+	/**
+	 * Heap memory of the column, shared sections are counted in full by every snapshot
+	 * holding them
+	 */
+	SIZE_T GetAllocatedSize() const
+	{
+		SIZE_T Size = Sections.GetAllocatedSize();
+		for (const auto& Section : Sections)
+		{
+			if (Section.Mixed)
+			{
+				Size += sizeof(FHierarchicalGrid) + Section.Mixed->GetAllocatedSize();
+			}
+		}
+
+		return Size;
+	}
+
+private:
+	/**
+	 * Uniform, or shared in its own block
+	 */
+	struct FSection
+	{
+		TSharedPtr<FHierarchicalGrid, ESPMode::ThreadSafe> Mixed;
+
+		FHierarchicalGrid Uniform;
+
+		const FHierarchicalGrid& Get() const
+		{
+			return Mixed ? *Mixed : Uniform;
+		}
+	};
+
+	TArray<FSection, TInlineAllocator<FGameConstants::ChunksInZ>> Sections;
+};
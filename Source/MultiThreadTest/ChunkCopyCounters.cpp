@@ -0,0 +1,5 @@
+﻿#include "ChunkCopyCounters.h"
+
+std::atomic<uint64> FChunkCopyCounters::ColumnCopies{0};
+
+std::atomic<uint64> FChunkCopyCounters::SectionCopies{0};
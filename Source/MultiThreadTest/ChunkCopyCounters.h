@@ -0,0 +1,21 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Deep copies of voxel data since startup, from any thread. Columns and sections are meant
+ * to be moved or shared (see FChunkColumnSnapshot), so these should only grow on edits
+ */
+struct MULTITHREADTEST_API FChunkCopyCounters
+{
+	/**
+	 * Whole FChunkDataColumn copies
+	 */
+	static std::atomic<uint64> ColumnCopies;
+
+	/**
+	 * Sections copied on write by FChunkColumnSnapshot::EditSection
+	 */
+	static std::atomic<uint64> SectionCopies;
+};
@@ -1,10 +1,63 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
+#include "ChunkCopyCounters.h"
 #include "Constants/GameConstants.h"
+#include "Structs/HierarchialGrid.h"
 #include "ChunkDataColumn.generated.h"
 
-struct FHierarchicalGrid;
+/**
+ * Where the terrain of a column is, in world blocks: every block under Min is solid and every
+ * block from Max up is air, only the sections in between need looking at. Exact when
+ * generated, rounded out to whole sections when rebuilt from the sections
+ */
+struct FColumnHeights
+{
+	uint16 Min = 0;
+
+	uint16 Max = FGameConstants::WorldHeight;
+
+	/**
+	 * First section that isn't fully under Min
+	 */
+	int32 GetFirstSection() const
+	{
+		return Min / FGameConstants::ChunkSize;
+	}
+
+	/**
+	 * One past the last section that isn't fully from Max up
+	 */
+	int32 GetEndSection() const
+	{
+		return FMath::DivideAndRoundUp<int32>(Max, FGameConstants::ChunkSize);
+	}
+
+	/**
+	 * ColumnType is FChunkDataColumn or FChunkColumnSnapshot, anything with tagged sections
+	 */
+	template <typename ColumnType>
+	static FColumnHeights FromSections(const ColumnType& Column)
+	{
+		int32 SolidBelow = 0;
+		while (SolidBelow < Column.NumSections() &&
+			Column.GetSection(SolidBelow).GetTag() == ESectionTag::Solid)
+		{
+			SolidBelow++;
+		}
+
+		int32 OccupiedEnd = Column.NumSections();
+		while (OccupiedEnd > 0 && Column.GetSection(OccupiedEnd - 1).GetTag() == ESectionTag::Air)
+		{
+			OccupiedEnd--;
+		}
+
+		FColumnHeights Heights;
+		Heights.Min = SolidBelow * FGameConstants::ChunkSize;
+		Heights.Max = FMath::Max(OccupiedEnd, SolidBelow) * FGameConstants::ChunkSize;
+		return Heights;
+	}
+};
 
 USTRUCT(BlueprintType)
 struct FChunkDataColumn
@@ -13,17 +66,118 @@ struct FChunkDataColumn
 
 	FChunkDataColumn(): ColumnPos()
 	{
-		ChunkDatas.SetNum(FGameConstants::ChunkSize);
+		ChunkDatas.SetNum(FGameConstants::ChunksInZ);
 	}
 
 	explicit FChunkDataColumn(const FIntVector2 InColumnPos): ColumnPos(InColumnPos)
 	{
-		ChunkDatas.SetNum(FGameConstants::ChunkSize);
+		ChunkDatas.SetNum(FGameConstants::ChunksInZ);
+	}
+
+	/**
+	 * Deep copy of every section, counted in FChunkCopyCounters. Columns are meant to be
+	 * moved, or shared once published (see FChunkColumnSnapshot)
+	 */
+	FChunkDataColumn(const FChunkDataColumn& Other): ColumnPos(Other.ColumnPos),
+	                                                 ChunkDatas(Other.ChunkDatas),
+	                                                 Heights(Other.Heights),
+	                                                 DispatchCycles(Other.DispatchCycles)
+	{
+		FChunkCopyCounters::ColumnCopies.fetch_add(1, std::memory_order_relaxed);
 	}
 
+	FChunkDataColumn(FChunkDataColumn&&) = default;
+
+	FChunkDataColumn& operator=(const FChunkDataColumn& Other)
+	{
+		ColumnPos = Other.ColumnPos;
+		ChunkDatas = Other.ChunkDatas;
+		Heights = Other.Heights;
+		DispatchCycles = Other.DispatchCycles;
+		FChunkCopyCounters::ColumnCopies.fetch_add(1, std::memory_order_relaxed);
+		return *this;
+	}
+
+	FChunkDataColumn& operator=(FChunkDataColumn&&) = default;
+
 	UPROPERTY()
 	FIntVector2 ColumnPos;
 
 	UPROPERTY()
 	TArray<FHierarchicalGrid> ChunkDatas;
+
+	/**
+	 * Not serialized, rebuilt from the sections when loaded
+	 */
+	FColumnHeights Heights;
+
+	/**
+	 * FColumnJob::EnqueueCycles of the generate job that produced it, 0 otherwise. Tells the
+	 * result of an outdated dispatch apart when the column was dispatched again meanwhile
+	 */
+	uint64 DispatchCycles = 0;
+
+	void RebuildHeights()
+	{
+		Heights = FColumnHeights::FromSections(*this);
+	}
+
+	int32 NumSections() const
+	{
+		return ChunkDatas.Num();
+	}
+
+	const FHierarchicalGrid& GetSection(const int32 ChunkZ) const
+	{
+		return ChunkDatas[ChunkZ];
+	}
+
+	/**
+	 * Resolution of the sections, all of a column's sections share the same one
+	 */
+	uint8 GetResolution() const
+	{
+		return ChunkDatas.Num() ? ChunkDatas[0].Resolution : FGameConstants::ChunkSize;
+	}
+
+	/**
+	 * Heap memory owned by the column: the section array plus one block per non uniform
+	 * section (rows and cols are stored inline in their layers)
+	 */
+	SIZE_T GetAllocatedSize() const
+	{
+		SIZE_T Size = ChunkDatas.GetAllocatedSize();
+		for (const auto& Grid : ChunkDatas)
+		{
+			Size += Grid.GetAllocatedSize();
+		}
+
+		return Size;
+	}
+
+	bool Serialize(FArchive& Ar)
+	{
+		Ar << ColumnPos << ChunkDatas;
+		if (Ar.IsLoading())
+		{
+			RebuildHeights();
+		}
+
+		return true;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FChunkDataColumn& Column)
+	{
+		Column.Serialize(Ar);
+		return Ar;
+	}
+};
+
+template <>
+struct TStructOpsTypeTraits<FChunkDataColumn> : TStructOpsTypeTraitsBase2<FChunkDataColumn>
+{
+	enum
+	{
+		WithSerializer = true,
+	};
 };
@@ -88,6 +88,46 @@ public:
 		return PositionsAroundPlayer;
 	}
 
+	/**
+	 * Call Function for every position around NewColumn within NewDistance that isn't within
+	 * OldDistance of OldColumn, row by row. Only the strips that differ are visited, so moving
+	 * by one column costs one edge of the square and not the whole square. Without an old
+	 * column every position around NewColumn is visited
+	 */
+	template <typename FunctionType>
+	static void ForEachPositionEntering(const FIntVector2 NewColumn, const int NewDistance,
+	                                    const TOptional<FIntVector2>& OldColumn,
+	                                    const int OldDistance, FunctionType&& Function)
+	{
+		for (int X = NewColumn.X - NewDistance; X <= NewColumn.X + NewDistance; X++)
+		{
+			const int MinY = NewColumn.Y - NewDistance;
+			const int MaxY = NewColumn.Y + NewDistance;
+
+			// The whole row is new
+			if (!OldColumn.IsSet() || FMath::Abs(X - OldColumn->X) > OldDistance)
+			{
+				for (int Y = MinY; Y <= MaxY; Y++)
+				{
+					Function(FIntVector2{X, Y});
+				}
+
+				continue;
+			}
+
+			// Only what sticks out of the old square on either side
+			for (int Y = MinY; Y <= FMath::Min(MaxY, OldColumn->Y - OldDistance - 1); Y++)
+			{
+				Function(FIntVector2{X, Y});
+			}
+
+			for (int Y = FMath::Max(MinY, OldColumn->Y + OldDistance + 1); Y <= MaxY; Y++)
+			{
+				Function(FIntVector2{X, Y});
+			}
+		}
+	}
+
 	static TArray<FIntVector2> GetNeighborPositions(const FIntVector2& OriginColumn)
 	{
 		return {
@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkDataColumn.h"
+
+/**
+ * Memory used by a set of columns, added up section by section.
+ *
+ * The compression ratio is against a dense array of 4 byte blocks at the same resolution
+ * (16³×4 bytes for a full resolution section), above 1 means the span encoding is smaller.
+ */
+struct FChunkMemoryStats
+{
+	int32 Columns = 0;
+
+	int32 Sections = 0;
+
+	int32 UniformSections = 0;
+
+	int64 Spans = 0;
+
+	/**
+	 * sizeof of the columns themselves, wherever they are stored
+	 */
+	int64 InlineBytes = 0;
+
+	/**
+	 * Heap memory owned by the columns, see FChunkDataColumn::GetAllocatedSize
+	 */
+	int64 AllocatedBytes = 0;
+
+	int64 DenseBytes = 0;
+
+	/**
+	 * ColumnType is FChunkDataColumn or FChunkColumnSnapshot
+	 */
+	template <typename ColumnType>
+	static FChunkMemoryStats FromColumn(const ColumnType& Column)
+	{
+		FChunkMemoryStats Stats;
+		Stats.Columns = 1;
+		Stats.Sections = Column.NumSections();
+		Stats.InlineBytes = sizeof(ColumnType);
+		Stats.AllocatedBytes = Column.GetAllocatedSize();
+
+		for (int32 ChunkZ = 0; ChunkZ < Column.NumSections(); ChunkZ++)
+		{
+			const FHierarchicalGrid& Grid = Column.GetSection(ChunkZ);
+			Stats.UniformSections += Grid.IsUniform();
+			Stats.Spans += Grid.NumSpans();
+			Stats.DenseBytes += static_cast<int64>(Grid.Resolution) * Grid.Resolution *
+				Grid.Resolution * sizeof(uint32);
+		}
+
+		return Stats;
+	}
+
+	int64 GetTotalBytes() const
+	{
+		return InlineBytes + AllocatedBytes;
+	}
+
+	double GetBytesPerColumn() const
+	{
+		return Columns ? static_cast<double>(GetTotalBytes()) / Columns : 0;
+	}
+
+	double GetSpansPerSection() const
+	{
+		return Sections ? static_cast<double>(Spans) / Sections : 0;
+	}
+
+	double GetCompressionRatio() const
+	{
+		return GetTotalBytes() ? static_cast<double>(DenseBytes) / GetTotalBytes() : 0;
+	}
+
+	FChunkMemoryStats& operator+=(const FChunkMemoryStats& Other)
+	{
+		Columns += Other.Columns;
+		Sections += Other.Sections;
+		UniformSections += Other.UniformSections;
+		Spans += Other.Spans;
+		InlineBytes += Other.InlineBytes;
+		AllocatedBytes += Other.AllocatedBytes;
+		DenseBytes += Other.DenseBytes;
+		return *this;
+	}
+
+	FChunkMemoryStats& operator-=(const FChunkMemoryStats& Other)
+	{
+		Columns -= Other.Columns;
+		Sections -= Other.Sections;
+		UniformSections -= Other.UniformSections;
+		Spans -= Other.Spans;
+		InlineBytes -= Other.InlineBytes;
+		AllocatedBytes -= Other.AllocatedBytes;
+		DenseBytes -= Other.DenseBytes;
+		return *this;
+	}
+
+	void Dump(FOutputDevice& Ar) const
+	{
+		Ar.Logf(TEXT("Columns: %d, sections: %d (%d uniform)"), Columns, Sections, UniformSections);
+		Ar.Logf(TEXT("Bytes: %lld (%lld inline, %lld allocated), %.1f per column"),
+		        GetTotalBytes(), InlineBytes, AllocatedBytes, GetBytesPerColumn());
+		Ar.Logf(TEXT("Spans: %lld, %.2f per section"), Spans, GetSpansPerSection());
+		Ar.Logf(TEXT("Dense: %lld bytes, compression ratio %.2f"), DenseBytes,
+		        GetCompressionRatio());
+	}
+};
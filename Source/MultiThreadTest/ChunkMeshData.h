@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ObjectPool.h"
+
+/**
+ * CPU side mesh of one section, laid out like the arguments of
+ * UProceduralMeshComponent::CreateMeshSection so the game thread can upload it as is.
+ * Positions are local to the section, in world units.
+ *
+ * The block id of every quad is in its vertex colors (R low byte, G high byte), so a texture
+ * array material can pick the layer.
+ */
+struct FChunkMeshData
+{
+	TArray<FVector> Vertices;
+
+	TArray<int32> Triangles;
+
+	TArray<FVector> Normals;
+
+	TArray<FVector2D> UVs;
+
+	TArray<FColor> Colors;
+
+	/**
+	 * Pooled and emptied mesh, its arrays keep the capacity of their previous use
+	 */
+	static TPooledObject<FChunkMeshData> Acquire()
+	{
+		TPooledObject<FChunkMeshData> Mesh{GetPool()};
+		Mesh->Reset();
+		return Mesh;
+	}
+
+	void Reset()
+	{
+		Vertices.Reset();
+		Triangles.Reset();
+		Normals.Reset();
+		UVs.Reset();
+		Colors.Reset();
+	}
+
+	bool IsEmpty() const
+	{
+		return Triangles.Num() == 0;
+	}
+
+	int32 NumTriangles() const
+	{
+		return Triangles.Num() / 3;
+	}
+
+private:
+	static TObjectPool<FChunkMeshData>& GetPool()
+	{
+		static TObjectPool<FChunkMeshData> Pool;
+		return Pool;
+	}
+};
+
+/**
+ * Mesh of a section, as handed from the workers to the game thread
+ */
+struct FChunkMesh
+{
+	/**
+	 * Column X and Y, section index in Z
+	 */
+	FIntVector ChunkPos;
+
+	TPooledObject<FChunkMeshData> Data;
+};
@@ -0,0 +1,370 @@
+﻿#include "ChunkMesher.h"
+
+#include "ChunkColumnSnapshot.h"
+#include "ChunkDataColumn.h"
+#include "ChunkMeshData.h"
+#include "ChunksStat.h"
+#include "Constants/GameConstants.h"
+#include "Structs/HierarchialGrid.h"
+
+namespace
+{
+	/**
+	 * For every axis and every plane between two slices (Resolution + 1 of them, borders
+	 * included), the block right after the plane (Front) and right before it (Back). Only
+	 * the cells where a box starts or ends are written, everywhere else both stay 0 and
+	 * produce no face
+	 */
+	struct FPlaneMasks
+	{
+		int32 Resolution = 0;
+
+		TArray<uint32> Front;
+
+		TArray<uint32> Back;
+
+		void Reset(const int32 InResolution)
+		{
+			Resolution = InResolution;
+			const int32 Num = 3 * (Resolution + 1) * Resolution * Resolution;
+			Front.SetNumUninitialized(Num);
+			Back.SetNumUninitialized(Num);
+			FMemory::Memzero(Front.GetData(), Num * sizeof(uint32));
+			FMemory::Memzero(Back.GetData(), Num * sizeof(uint32));
+		}
+
+		int32 Index(const int32 Axis, const int32 Plane, const int32 U, const int32 V) const
+		{
+			return ((Axis * (Resolution + 1) + Plane) * Resolution + U) * Resolution + V;
+		}
+
+		/**
+		 * Write BlockId over the UV rectangle of the box, in the given plane
+		 */
+		static void Stamp(TArray<uint32>& Masks, const int32 Start, const int32 Resolution,
+		                  const FIntVector& Min, const FIntVector& Max, const int32 AxisU,
+		                  const int32 AxisV, const uint32 BlockId)
+		{
+			for (int32 U = Min[AxisU]; U <= Max[AxisU]; U++)
+			{
+				uint32* Row = Masks.GetData() + Start + U * Resolution;
+				for (int32 V = Min[AxisV]; V <= Max[AxisV]; V++)
+				{
+					Row[V] = BlockId;
+				}
+			}
+		}
+	};
+
+	constexpr int32 AxisU(const int32 Axis)
+	{
+		return (Axis + 1) % 3;
+	}
+
+	constexpr int32 AxisV(const int32 Axis)
+	{
+		return (Axis + 2) % 3;
+	}
+
+	void StampGrid(FPlaneMasks& Masks, const FHierarchicalGrid& Grid)
+	{
+		Grid.ForEachUniformBox([&Masks](const FIntVector& Min, const FIntVector& Max,
+		                                const uint32 BlockId)
+		{
+			for (int32 Axis = 0; Axis < 3; Axis++)
+			{
+				FPlaneMasks::Stamp(Masks.Front, Masks.Index(Axis, Min[Axis], 0, 0), Masks.Resolution,
+				                   Min, Max, AxisU(Axis), AxisV(Axis), BlockId);
+				FPlaneMasks::Stamp(Masks.Back, Masks.Index(Axis, Max[Axis] + 1, 0, 0),
+				                   Masks.Resolution, Min, Max, AxisU(Axis), AxisV(Axis), BlockId);
+			}
+		});
+	}
+
+	/**
+	 * Fill the outer side of a border plane with the touching slice of the neighbor
+	 */
+	void StampNeighbor(FPlaneMasks& Masks, const FHierarchicalGrid& Neighbor, const int32 Axis,
+	                   const bool bPositive)
+	{
+		const int32 Resolution = Masks.Resolution;
+		const int32 Plane = bPositive ? Resolution : 0;
+		const int32 Start = Masks.Index(Axis, Plane, 0, 0);
+
+		Neighbor.ForEachUniformBox([&](const FIntVector& Min, const FIntVector& Max,
+		                               const uint32 BlockId)
+		{
+			// Only the boxes touching our side of the border matter
+			if (bPositive ? Min[Axis] != 0 : Max[Axis] != Resolution - 1)
+			{
+				return;
+			}
+
+			FPlaneMasks::Stamp(bPositive ? Masks.Front : Masks.Back, Start, Resolution, Min, Max,
+			                   AxisU(Axis), AxisV(Axis), BlockId);
+		});
+	}
+
+	void EmitQuad(FChunkMeshData& OutMesh, const int32 Axis, const bool bPositive,
+	              const int32 Plane, const int32 U, const int32 V, const int32 SizeU,
+	              const int32 SizeV, const uint32 BlockId, const double VoxelSize,
+	              const double BlocksPerVoxel)
+	{
+		const int32 First = OutMesh.Vertices.Num();
+
+		FVector Normal = FVector::ZeroVector;
+		Normal[Axis] = bPositive ? 1 : -1;
+
+		const FColor Color(BlockId & 0xFF, BlockId >> 8 & 0xFF, 0);
+		const int32 Corners[4][2] = {{0, 0}, {SizeU, 0}, {SizeU, SizeV}, {0, SizeV}};
+		for (const auto& Corner : Corners)
+		{
+			FVector Position;
+			Position[Axis] = Plane * VoxelSize;
+			Position[AxisU(Axis)] = (U + Corner[0]) * VoxelSize;
+			Position[AxisV(Axis)] = (V + Corner[1]) * VoxelSize;
+
+			OutMesh.Vertices.Add(Position);
+			OutMesh.Normals.Add(Normal);
+			OutMesh.UVs.Add(FVector2D(Corner[0] * BlocksPerVoxel, Corner[1] * BlocksPerVoxel));
+			OutMesh.Colors.Add(Color);
+		}
+
+		// U x V points along +Axis, so this order winds clockwise seen from the +Axis side,
+		// which is what UE takes as the front face. Faces looking the other way are flipped
+		if (bPositive)
+		{
+			OutMesh.Triangles.Append({First, First + 1, First + 2, First, First + 2, First + 3});
+		}
+		else
+		{
+			OutMesh.Triangles.Append({First, First + 2, First + 1, First, First + 3, First + 2});
+		}
+	}
+
+	/**
+	 * Merge the faces of a plane into as few rectangles as possible, Faces is consumed
+	 */
+	void GreedyMerge(FChunkMeshData& OutMesh, uint32* Faces, const int32 Resolution,
+	                 const int32 Axis, const bool bPositive, const int32 Plane,
+	                 const double VoxelSize, const double BlocksPerVoxel)
+	{
+		for (int32 U = 0; U < Resolution; U++)
+		{
+			for (int32 V = 0; V < Resolution; V++)
+			{
+				const uint32 BlockId = Faces[U * Resolution + V];
+				if (!BlockId)
+				{
+					continue;
+				}
+
+				int32 SizeV = 1;
+				while (V + SizeV < Resolution && Faces[U * Resolution + V + SizeV] == BlockId)
+				{
+					SizeV++;
+				}
+
+				int32 SizeU = 1;
+				for (; U + SizeU < Resolution; SizeU++)
+				{
+					const uint32* Row = Faces + (U + SizeU) * Resolution + V;
+					bool bSameRun = true;
+					for (int32 Offset = 0; Offset < SizeV && bSameRun; Offset++)
+					{
+						bSameRun = Row[Offset] == BlockId;
+					}
+
+					if (!bSameRun)
+					{
+						break;
+					}
+				}
+
+				for (int32 ClearU = U; ClearU < U + SizeU; ClearU++)
+				{
+					FMemory::Memzero(Faces + ClearU * Resolution + V, SizeV * sizeof(uint32));
+				}
+
+				EmitQuad(OutMesh, Axis, bPositive, Plane, U, V, SizeU, SizeV, BlockId, VoxelSize,
+				         BlocksPerVoxel);
+			}
+		}
+	}
+}
+
+void FChunkMesher::Build(const FHierarchicalGrid& Grid, const FChunkMeshNeighbors& Neighbors,
+                         FChunkMeshData& OutMesh)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RenderChunk);
+
+	// Nothing to draw, and nothing can show through from the neighbors
+	if (Grid.IsUniform() && Grid.BlockId == 0)
+	{
+		return;
+	}
+
+	const int32 Resolution = Grid.Resolution;
+	const double BlocksPerVoxel = static_cast<double>(FGameConstants::ChunkSize) / Resolution;
+	const double VoxelSize = BlocksPerVoxel * FGameConstants::ScaleMultiplier;
+
+	static thread_local FPlaneMasks Masks;
+	Masks.Reset(Resolution);
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ChunkRenderForEachPiece);
+
+		StampGrid(Masks, Grid);
+		for (int32 Side = 0; Side < FChunkMeshNeighbors::Count; Side++)
+		{
+			const FHierarchicalGrid* Neighbor = Neighbors.Grids[Side];
+			if (Neighbor && Neighbor->Resolution == Resolution)
+			{
+				StampNeighbor(Masks, *Neighbor, Side / 2, Side % 2 == 1);
+			}
+		}
+	}
+
+	TStaticArray<uint32, FGameConstants::ChunkSize * FGameConstants::ChunkSize> PositiveFaces;
+	TStaticArray<uint32, FGameConstants::ChunkSize * FGameConstants::ChunkSize> NegativeFaces;
+	const int32 PlaneSize = Resolution * Resolution;
+
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		for (int32 Plane = 0; Plane <= Resolution; Plane++)
+		{
+			const int32 Start = Masks.Index(Axis, Plane, 0, 0);
+			const uint32* Front = Masks.Front.GetData() + Start;
+			const uint32* Back = Masks.Back.GetData() + Start;
+
+			// A face shows where exactly one side of the plane is air
+			bool bAnyFace = false;
+			for (int32 Idx = 0; Idx < PlaneSize; Idx++)
+			{
+				PositiveFaces[Idx] = Front[Idx] ? 0 : Back[Idx];
+				NegativeFaces[Idx] = Back[Idx] ? 0 : Front[Idx];
+				bAnyFace |= (PositiveFaces[Idx] | NegativeFaces[Idx]) != 0;
+			}
+
+			if (!bAnyFace)
+			{
+				continue;
+			}
+
+			GreedyMerge(OutMesh, PositiveFaces.GetData(), Resolution, Axis, true, Plane, VoxelSize,
+			            BlocksPerVoxel);
+			GreedyMerge(OutMesh, NegativeFaces.GetData(), Resolution, Axis, false, Plane,
+			            VoxelSize, BlocksPerVoxel);
+		}
+	}
+}
+
+namespace
+{
+	/**
+	 * ColumnType is FChunkDataColumn or FChunkColumnSnapshot, anything with sections
+	 */
+	template <typename ColumnType>
+	bool ColumnSectionNeedsMesh(const ColumnType& Column, const int32 ChunkZ,
+	                            const TConstArrayView<const ColumnType*> SideColumns)
+	{
+		const FHierarchicalGrid& Section = Column.GetSection(ChunkZ);
+		switch (Section.GetTag())
+		{
+		case ESectionTag::Air:
+			return false;
+		case ESectionTag::Mixed:
+			return true;
+		case ESectionTag::Solid:
+			break;
+		}
+
+		const auto IsSolid = [&Section](const ColumnType* Other, const int32 OtherZ)
+		{
+			if (!Other || OtherZ < 0 || OtherZ >= Other->NumSections())
+			{
+				return false;
+			}
+
+			const FHierarchicalGrid& OtherSection = Other->GetSection(OtherZ);
+			return OtherSection.GetTag() == ESectionTag::Solid &&
+				OtherSection.Resolution == Section.Resolution;
+		};
+
+		if (SideColumns.Num() != FChunkMeshNeighbors::NegZ ||
+			!IsSolid(&Column, ChunkZ - 1) || !IsSolid(&Column, ChunkZ + 1))
+		{
+			return true;
+		}
+
+		for (const ColumnType* SideColumn : SideColumns)
+		{
+			if (!IsSolid(SideColumn, ChunkZ))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template <typename ColumnType>
+	void BuildColumnSection(const ColumnType& Column, const int32 ChunkZ, FChunkMeshData& OutMesh,
+	                        const TConstArrayView<const ColumnType*> SideColumns)
+	{
+		check(SideColumns.IsEmpty() || SideColumns.Num() == FChunkMeshNeighbors::NegZ);
+
+		if (!ColumnSectionNeedsMesh(Column, ChunkZ, SideColumns))
+		{
+			return;
+		}
+
+		FChunkMeshNeighbors Neighbors;
+		for (int32 Side = 0; Side < SideColumns.Num(); Side++)
+		{
+			const ColumnType* SideColumn = SideColumns[Side];
+			if (SideColumn && ChunkZ < SideColumn->NumSections())
+			{
+				Neighbors.Grids[Side] = &SideColumn->GetSection(ChunkZ);
+			}
+		}
+
+		if (ChunkZ > 0)
+		{
+			Neighbors.Grids[FChunkMeshNeighbors::NegZ] = &Column.GetSection(ChunkZ - 1);
+		}
+
+		if (ChunkZ + 1 < Column.NumSections())
+		{
+			Neighbors.Grids[FChunkMeshNeighbors::PosZ] = &Column.GetSection(ChunkZ + 1);
+		}
+
+		FChunkMesher::Build(Column.GetSection(ChunkZ), Neighbors, OutMesh);
+	}
+}
+
+void FChunkMesher::BuildSection(const FChunkDataColumn& Column, const int32 ChunkZ,
+                                FChunkMeshData& OutMesh,
+                                const TConstArrayView<const FChunkDataColumn*> SideColumns)
+{
+	BuildColumnSection(Column, ChunkZ, OutMesh, SideColumns);
+}
+
+void FChunkMesher::BuildSection(const FChunkColumnSnapshot& Column, const int32 ChunkZ,
+                                FChunkMeshData& OutMesh,
+                                const TConstArrayView<const FChunkColumnSnapshot*> SideColumns)
+{
+	BuildColumnSection(Column, ChunkZ, OutMesh, SideColumns);
+}
+
+bool FChunkMesher::NeedsMesh(const FChunkDataColumn& Column, const int32 ChunkZ,
+                             const TConstArrayView<const FChunkDataColumn*> SideColumns)
+{
+	return ColumnSectionNeedsMesh(Column, ChunkZ, SideColumns);
+}
+
+bool FChunkMesher::NeedsMesh(const FChunkColumnSnapshot& Column, const int32 ChunkZ,
+                             const TConstArrayView<const FChunkColumnSnapshot*> SideColumns)
+{
+	return ColumnSectionNeedsMesh(Column, ChunkZ, SideColumns);
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+struct FChunkColumnSnapshot;
+struct FChunkDataColumn;
+struct FChunkMeshData;
+struct FHierarchicalGrid;
+
+/**
+ * Neighbor sections, so faces against solid blocks across the section border are culled.
+ * A missing neighbor (or one with another resolution) counts as air
+ */
+struct FChunkMeshNeighbors
+{
+	enum ESide
+	{
+		NegX,
+		PosX,
+		NegY,
+		PosY,
+		NegZ,
+		PosZ,
+		Count
+	};
+
+	const FHierarchicalGrid* Grids[Count] = {};
+};
+
+/**
+ * Builds section meshes from the span encoding, thread safe.
+ *
+ * Every uniform box of the grid (see FHierarchicalGrid::ForEachUniformBox) stamps its two
+ * faces on each axis into per plane masks, then the exposed faces of each plane are merged
+ * into quads greedily. The cost follows the surface of the boxes, never the block count,
+ * and a section made of a few spans turns into a few quads. Block 0 is air, every other
+ * block is opaque.
+ */
+struct FChunkMesher
+{
+	static void Build(const FHierarchicalGrid& Grid, const FChunkMeshNeighbors& Neighbors,
+	                  FChunkMeshData& OutMesh);
+
+	/**
+	 * Mesh one section of the column, with the sections above and below as neighbors. When
+	 * given, SideColumns are the columns around in NegX, PosX, NegY, PosY order (null where
+	 * missing), and their sections at the same height are the side neighbors
+	 */
+	static void BuildSection(const FChunkDataColumn& Column, int32 ChunkZ, FChunkMeshData& OutMesh,
+	                         TConstArrayView<const FChunkDataColumn*> SideColumns = {});
+
+	static void BuildSection(const FChunkColumnSnapshot& Column, int32 ChunkZ,
+	                         FChunkMeshData& OutMesh,
+	                         TConstArrayView<const FChunkColumnSnapshot*> SideColumns = {});
+
+	/**
+	 * Whether BuildSection can produce anything, from the section tags alone: air sections
+	 * never do, and neither do solid ones surrounded by solid sections of the same resolution
+	 * on all six sides. Both are skipped by BuildSection too
+	 */
+	static bool NeedsMesh(const FChunkDataColumn& Column, int32 ChunkZ,
+	                      TConstArrayView<const FChunkDataColumn*> SideColumns = {});
+
+	static bool NeedsMesh(const FChunkColumnSnapshot& Column, int32 ChunkZ,
+	                      TConstArrayView<const FChunkColumnSnapshot*> SideColumns = {});
+};
@@ -0,0 +1,232 @@
+﻿#include "ChunkRegistry.h"
+
+#include "ChunksStat.h"
+
+bool UChunkRegistry::Add(const FIntVector2& ColumnPos, const EColumnState State)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ChunkRegistryRegisterChunk);
+
+	FShard& Shard = GetShard(ColumnPos);
+	FRWScopeLock Lock(Shard.Lock, SLT_Write);
+	if (Shard.Columns.Contains(ColumnPos))
+	{
+		return false;
+	}
+
+	Shard.Columns.Add(ColumnPos, FRegisteredColumn{State});
+	return true;
+}
+
+bool UChunkRegistry::SetState(const FIntVector2& ColumnPos, const EColumnState State)
+{
+	FShard& Shard = GetShard(ColumnPos);
+	FRWScopeLock Lock(Shard.Lock, SLT_Write);
+	FRegisteredColumn* Column = Shard.Columns.Find(ColumnPos);
+	if (!Column)
+	{
+		return false;
+	}
+
+	Column->State = State;
+	return true;
+}
+
+FColumnDataPtr UChunkRegistry::Register(FChunkDataColumn&& Column)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ChunkRegistryColumnSpawn);
+
+	const FIntVector2 ColumnPos = Column.ColumnPos;
+	FColumnDataPtr Data = MakeShared<const FChunkColumnSnapshot, ESPMode::ThreadSafe>(MoveTemp(Column));
+	const FChunkMemoryStats Memory = FChunkMemoryStats::FromColumn(*Data);
+
+	// The previous version, if any, is released outside of the lock
+	FColumnDataPtr Previous;
+	FShard& Shard = GetShard(ColumnPos);
+	{
+		FRWScopeLock Lock(Shard.Lock, SLT_Write);
+		FRegisteredColumn& Registered = Shard.Columns.FindOrAdd(ColumnPos);
+		Registered.State = EColumnState::Generated;
+		Previous = MoveTemp(Registered.Data);
+		Registered.Data = Data;
+		Shard.Memory += Memory;
+	}
+
+	// Walked outside of the lock too, the totals are off by one column in between
+	if (Previous)
+	{
+		const FChunkMemoryStats PreviousMemory = FChunkMemoryStats::FromColumn(*Previous);
+		FRWScopeLock Lock(Shard.Lock, SLT_Write);
+		Shard.Memory -= PreviousMemory;
+	}
+
+	return Data;
+}
+
+FColumnDataPtr UChunkRegistry::EditColumn(const FIntVector2& ColumnPos,
+                                          const TFunctionRef<void(FChunkColumnSnapshot&)> Edit)
+{
+	FShard& Shard = GetShard(ColumnPos);
+	for (;;)
+	{
+		const FColumnDataPtr Current = FindData(ColumnPos);
+		if (!Current)
+		{
+			return nullptr;
+		}
+
+		const TSharedRef<FChunkColumnSnapshot, ESPMode::ThreadSafe> Next = Current->Fork();
+		Edit(*Next);
+		Next->RebuildHeights();
+
+		const FChunkMemoryStats Memory = FChunkMemoryStats::FromColumn(*Next);
+		const FChunkMemoryStats CurrentMemory = FChunkMemoryStats::FromColumn(*Current);
+		{
+			FRWScopeLock Lock(Shard.Lock, SLT_Write);
+			FRegisteredColumn* Registered = Shard.Columns.Find(ColumnPos);
+			if (!Registered || !Registered->Data)
+			{
+				return nullptr;
+			}
+
+			// Regenerated or edited meanwhile, start over from that version
+			if (Registered->Data != Current)
+			{
+				continue;
+			}
+
+			Registered->State = EColumnState::Generated;
+			Registered->Data = Next;
+			Shard.Memory += Memory;
+			Shard.Memory -= CurrentMemory;
+		}
+
+		return Next;
+	}
+}
+
+FColumnDataPtr UChunkRegistry::ApplyEdits(const FIntVector2& ColumnPos, const int32 ChunkZ,
+                                          const TConstArrayView<FBlockEdit> Edits)
+{
+	if (ChunkZ < 0 || ChunkZ >= FGameConstants::ChunksInZ)
+	{
+		return nullptr;
+	}
+
+	const FColumnDataPtr Current = FindData(ColumnPos);
+	if (!Current)
+	{
+		return nullptr;
+	}
+
+	// Checked against the current version, a batch changing nothing copies nothing
+	const FHierarchicalGrid& Section = Current->GetSection(ChunkZ);
+	const bool bChanges = Edits.ContainsByPredicate([&Section](const FBlockEdit& Edit)
+	{
+		return Section.Get(Edit.X, Edit.Y, Edit.Z) != Edit.BlockId;
+	});
+
+	if (!bChanges)
+	{
+		return nullptr;
+	}
+
+	// The grid sorts and compacts the batch in place, every attempt starts from the caller's
+	TArray<FBlockEdit> Batch;
+	return EditColumn(ColumnPos, [&](FChunkColumnSnapshot& Column)
+	{
+		Batch.Reset();
+		Batch.Append(Edits.GetData(), Edits.Num());
+		Column.EditSection(ChunkZ).ApplyEdits(Batch);
+	});
+}
+
+bool UChunkRegistry::Remove(const FIntVector2& ColumnPos)
+{
+	// Destroyed after the lock is released, along with the data it may hold
+	FRegisteredColumn Removed;
+	FShard& Shard = GetShard(ColumnPos);
+	{
+		FRWScopeLock Lock(Shard.Lock, SLT_Write);
+		if (!Shard.Columns.RemoveAndCopyValue(ColumnPos, Removed))
+		{
+			return false;
+		}
+	}
+
+	if (Removed.Data)
+	{
+		const FChunkMemoryStats RemovedMemory = FChunkMemoryStats::FromColumn(*Removed.Data);
+		FRWScopeLock Lock(Shard.Lock, SLT_Write);
+		Shard.Memory -= RemovedMemory;
+	}
+
+	return true;
+}
+
+bool UChunkRegistry::Find(const FIntVector2& ColumnPos, FRegisteredColumn& OutColumn) const
+{
+	const FShard& Shard = GetShard(ColumnPos);
+	FRWScopeLock Lock(Shard.Lock, SLT_ReadOnly);
+	if (const FRegisteredColumn* Column = Shard.Columns.Find(ColumnPos))
+	{
+		OutColumn = *Column;
+		return true;
+	}
+
+	return false;
+}
+
+FColumnDataPtr UChunkRegistry::FindData(const FIntVector2& ColumnPos) const
+{
+	const FShard& Shard = GetShard(ColumnPos);
+	FRWScopeLock Lock(Shard.Lock, SLT_ReadOnly);
+	const FRegisteredColumn* Column = Shard.Columns.Find(ColumnPos);
+	return Column ? Column->Data : nullptr;
+}
+
+TOptional<EColumnState> UChunkRegistry::GetState(const FIntVector2& ColumnPos) const
+{
+	const FShard& Shard = GetShard(ColumnPos);
+	FRWScopeLock Lock(Shard.Lock, SLT_ReadOnly);
+	const FRegisteredColumn* Column = Shard.Columns.Find(ColumnPos);
+	return Column ? Column->State : TOptional<EColumnState>();
+}
+
+int32 UChunkRegistry::FindNeighbors(const FIntVector2& ColumnPos,
+                                    FColumnDataPtr (&OutNeighbors)[4]) const
+{
+	static const FIntVector2 Offsets[4] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+	int32 Found = 0;
+	for (int32 Side = 0; Side < 4; Side++)
+	{
+		OutNeighbors[Side] = FindData(ColumnPos + Offsets[Side]);
+		Found += OutNeighbors[Side].IsValid();
+	}
+
+	return Found;
+}
+
+int32 UChunkRegistry::Num() const
+{
+	int32 Count = 0;
+	for (const FShard& Shard : Shards)
+	{
+		FRWScopeLock Lock(Shard.Lock, SLT_ReadOnly);
+		Count += Shard.Columns.Num();
+	}
+
+	return Count;
+}
+
+FChunkMemoryStats UChunkRegistry::GetMemoryStats() const
+{
+	FChunkMemoryStats Memory;
+	for (const FShard& Shard : Shards)
+	{
+		FRWScopeLock Lock(Shard.Lock, SLT_ReadOnly);
+		Memory += Shard.Memory;
+	}
+
+	return Memory;
+}
@@ -0,0 +1,152 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkColumnSnapshot.h"
+#include "ChunkDataColumn.h"
+#include "ChunkMemoryStats.h"
+#include "Structs/BlockEdit.h"
+#include "ChunkRegistry.generated.h"
+
+/**
+ * Where a column is in its life, in order
+ */
+UENUM()
+enum class EColumnState : uint8
+{
+	/**
+	 * Wanted, waiting in the load scheduler
+	 */
+	Queued,
+
+	/**
+	 * Picked by a worker. A column requeued for another resolution goes back here too, its
+	 * data stays the old one until the new one is registered
+	 */
+	Generating,
+
+	/**
+	 * Produced by a worker, the data is in the registry once the game thread integrated it
+	 */
+	Generated,
+
+	/**
+	 * Its mesh job ran (see FColumnJobGraph), the meshes are on their way to the game thread
+	 */
+	Meshed,
+
+	/**
+	 * The game thread received its meshes, or its mesh job found nothing to draw
+	 */
+	Live,
+};
+
+using FColumnDataPtr = TSharedPtr<const FChunkColumnSnapshot, ESPMode::ThreadSafe>;
+
+struct FRegisteredColumn
+{
+	EColumnState State = EColumnState::Queued;
+
+	/**
+	 * Null until the game thread integrated the column. Immutable once registered, a new
+	 * version of the column (regenerated or edited) replaces the pointer
+	 */
+	FColumnDataPtr Data;
+};
+
+/**
+ * Every column the game knows about, with its state and, once integrated, its data.
+ *
+ * Readable and writable from any thread. Columns are spread over ShardCount maps by hash,
+ * each behind its own FRWLock, and a lock is only held to copy or swap an entry, never while
+ * working on the data. A worker reading the neighbors of a column only contends with
+ * writers of the same shard, for the time of a map lookup.
+ */
+UCLASS()
+class MULTITHREADTEST_API UChunkRegistry : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	static constexpr int32 ShardCount = 64;
+
+	/**
+	 * Start tracking a column, returns false if it already was
+	 */
+	bool Add(const FIntVector2& ColumnPos, EColumnState State = EColumnState::Queued);
+
+	/**
+	 * Move a tracked column to another state, returns false if it isn't tracked (e.g. it was
+	 * removed while a worker had it), then nothing is added
+	 */
+	bool SetState(const FIntVector2& ColumnPos, EColumnState State);
+
+	/**
+	 * Publish the data of a column, tracked or not, and set it Generated. Returns the shared
+	 * data
+	 */
+	FColumnDataPtr Register(FChunkDataColumn&& Column);
+
+	/**
+	 * Publish a new version of a registered column: Edit gets a fork of the current one,
+	 * sharing its sections (see FChunkColumnSnapshot::EditSection). Sets it Generated and
+	 * returns it, or null if the column has no data. Edit may run again if another version
+	 * was published meanwhile
+	 */
+	FColumnDataPtr EditColumn(const FIntVector2& ColumnPos,
+	                          TFunctionRef<void(FChunkColumnSnapshot&)> Edit);
+
+	/**
+	 * Write a batch of edits to one section (see FHierarchicalGrid::ApplyEdits), only that
+	 * section is copied and Edits is left as is. Returns the new version, or null if nothing
+	 * changed, the column has no data or ChunkZ isn't a section
+	 */
+	FColumnDataPtr ApplyEdits(const FIntVector2& ColumnPos, int32 ChunkZ,
+	                          TConstArrayView<FBlockEdit> Edits);
+
+	bool Remove(const FIntVector2& ColumnPos);
+
+	bool Find(const FIntVector2& ColumnPos, FRegisteredColumn& OutColumn) const;
+
+	FColumnDataPtr FindData(const FIntVector2& ColumnPos) const;
+
+	TOptional<EColumnState> GetState(const FIntVector2& ColumnPos) const;
+
+	/**
+	 * Data of the four side neighbors, in FChunkMeshNeighbors order (NegX, PosX, NegY, PosY),
+	 * null where not registered. Returns how many were found
+	 */
+	int32 FindNeighbors(const FIntVector2& ColumnPos, FColumnDataPtr (&OutNeighbors)[4]) const;
+
+	/**
+	 * Locks every shard in turn, only a snapshot when other threads are writing
+	 */
+	int32 Num() const;
+
+	/**
+	 * Memory of every registered column data, kept up to date by Register and Remove so it
+	 * doesn't walk the columns. Same snapshot caveat as Num
+	 */
+	FChunkMemoryStats GetMemoryStats() const;
+
+private:
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FShard
+	{
+		mutable FRWLock Lock;
+
+		TMap<FIntVector2, FRegisteredColumn> Columns;
+
+		FChunkMemoryStats Memory;
+	};
+
+	FShard& GetShard(const FIntVector2& ColumnPos)
+	{
+		return Shards[GetTypeHash(ColumnPos) % ShardCount];
+	}
+
+	const FShard& GetShard(const FIntVector2& ColumnPos) const
+	{
+		return Shards[GetTypeHash(ColumnPos) % ShardCount];
+	}
+
+	FShard Shards[ShardCount];
+};
@@ -0,0 +1,148 @@
+﻿#include "ChunkTrace.h"
+
+#include "ColumnJob.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+UE_TRACE_CHANNEL_DEFINE(ChunkPipelineChannel)
+
+#if CHUNK_TRACE_ENABLED
+
+UE_TRACE_EVENT_BEGIN(ChunkPipeline, JobDequeued)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, WaitCycles)
+	UE_TRACE_EVENT_FIELD(int32, X)
+	UE_TRACE_EVENT_FIELD(int32, Y)
+	UE_TRACE_EVENT_FIELD(uint32, WorkerId)
+	UE_TRACE_EVENT_FIELD(uint8, Kind)
+	UE_TRACE_EVENT_FIELD(uint8, Resolution)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ChunkPipeline, ColumnProduced)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(int32, X)
+	UE_TRACE_EVENT_FIELD(int32, Y)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ChunkPipeline, ColumnStaged)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(int32, X)
+	UE_TRACE_EVENT_FIELD(int32, Y)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ChunkPipeline, ColumnIntegrated)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, LatencyCycles)
+	UE_TRACE_EVENT_FIELD(int32, X)
+	UE_TRACE_EVENT_FIELD(int32, Y)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ChunkPipeline, QueueDepths)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(int32, JobQueue)
+	UE_TRACE_EVENT_FIELD(int32, CreateColumnQueue)
+	UE_TRACE_EVENT_FIELD(int32, MeshQueue)
+	UE_TRACE_EVENT_FIELD(int32, Staged)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(ChunkPipeline, WorkerIdle)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, IdleCycles)
+	UE_TRACE_EVENT_FIELD(uint32, WorkerId)
+UE_TRACE_EVENT_END()
+
+TRACE_DECLARE_INT_COUNTER(ChunkJobQueueDepth, TEXT("Chunks/JobQueue"));
+TRACE_DECLARE_INT_COUNTER(ChunkCreateColumnQueueDepth, TEXT("Chunks/CreateColumnQueue"));
+TRACE_DECLARE_INT_COUNTER(ChunkMeshQueueDepth, TEXT("Chunks/MeshQueue"));
+TRACE_DECLARE_INT_COUNTER(ChunkStagedColumns, TEXT("Chunks/Staged"));
+TRACE_DECLARE_FLOAT_COUNTER(ChunkColumnLatencyMs, TEXT("Chunks/ColumnLatencyMs"));
+
+void FChunkTrace::JobDequeued(const FColumnJob& Job, const uint64 WaitCycles)
+{
+	UE_TRACE_LOG(ChunkPipeline, JobDequeued, ChunkPipelineChannel)
+		<< JobDequeued.Cycle(FPlatformTime::Cycles64())
+		<< JobDequeued.WaitCycles(WaitCycles)
+		<< JobDequeued.X(Job.ColumnPos.X)
+		<< JobDequeued.Y(Job.ColumnPos.Y)
+		<< JobDequeued.WorkerId(FPlatformTLS::GetCurrentThreadId())
+		<< JobDequeued.Kind(static_cast<uint8>(Job.Kind))
+		<< JobDequeued.Resolution(Job.Resolution);
+}
+
+void FChunkTrace::ColumnProduced(const FIntVector2& ColumnPos)
+{
+	UE_TRACE_LOG(ChunkPipeline, ColumnProduced, ChunkPipelineChannel)
+		<< ColumnProduced.Cycle(FPlatformTime::Cycles64())
+		<< ColumnProduced.X(ColumnPos.X)
+		<< ColumnProduced.Y(ColumnPos.Y);
+}
+
+void FChunkTrace::ColumnStaged(const FIntVector2& ColumnPos)
+{
+	UE_TRACE_LOG(ChunkPipeline, ColumnStaged, ChunkPipelineChannel)
+		<< ColumnStaged.Cycle(FPlatformTime::Cycles64())
+		<< ColumnStaged.X(ColumnPos.X)
+		<< ColumnStaged.Y(ColumnPos.Y);
+}
+
+void FChunkTrace::ColumnIntegrated(const FIntVector2& ColumnPos, const uint64 LatencyCycles)
+{
+	UE_TRACE_LOG(ChunkPipeline, ColumnIntegrated, ChunkPipelineChannel)
+		<< ColumnIntegrated.Cycle(FPlatformTime::Cycles64())
+		<< ColumnIntegrated.LatencyCycles(LatencyCycles)
+		<< ColumnIntegrated.X(ColumnPos.X)
+		<< ColumnIntegrated.Y(ColumnPos.Y);
+
+	TRACE_COUNTER_SET(ChunkColumnLatencyMs, FPlatformTime::ToMilliseconds64(LatencyCycles));
+}
+
+void FChunkTrace::QueueDepths(const int32 JobQueue, const int32 CreateColumnQueue,
+                              const int32 MeshQueue, const int32 Staged)
+{
+	UE_TRACE_LOG(ChunkPipeline, QueueDepths, ChunkPipelineChannel)
+		<< QueueDepths.Cycle(FPlatformTime::Cycles64())
+		<< QueueDepths.JobQueue(JobQueue)
+		<< QueueDepths.CreateColumnQueue(CreateColumnQueue)
+		<< QueueDepths.MeshQueue(MeshQueue)
+		<< QueueDepths.Staged(Staged);
+
+	TRACE_COUNTER_SET(ChunkJobQueueDepth, JobQueue);
+	TRACE_COUNTER_SET(ChunkCreateColumnQueueDepth, CreateColumnQueue);
+	TRACE_COUNTER_SET(ChunkMeshQueueDepth, MeshQueue);
+	TRACE_COUNTER_SET(ChunkStagedColumns, Staged);
+}
+
+void FChunkTrace::WorkerIdle(const uint64 IdleCycles)
+{
+	UE_TRACE_LOG(ChunkPipeline, WorkerIdle, ChunkPipelineChannel)
+		<< WorkerIdle.Cycle(FPlatformTime::Cycles64())
+		<< WorkerIdle.IdleCycles(IdleCycles)
+		<< WorkerIdle.WorkerId(FPlatformTLS::GetCurrentThreadId());
+}
+
+#else
+
+void FChunkTrace::JobDequeued(const FColumnJob&, uint64)
+{
+}
+
+void FChunkTrace::ColumnProduced(const FIntVector2&)
+{
+}
+
+void FChunkTrace::ColumnStaged(const FIntVector2&)
+{
+}
+
+void FChunkTrace::ColumnIntegrated(const FIntVector2&, uint64)
+{
+}
+
+void FChunkTrace::QueueDepths(int32, int32, int32, int32)
+{
+}
+
+void FChunkTrace::WorkerIdle(uint64)
+{
+}
+
+#endif
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+struct FColumnJob;
+
+/**
+ * How much of the chunk pipeline is instrumented, set it from the target or Build.cs:
+ * - 0: nothing
+ * - 1: pipeline stages, queue waits and depths, worker busy/idle and per column latency
+ * - 2: also one scope per section generated or meshed
+ * - 3: also the per voxel scopes, which cost more than the work they measure
+ */
+#ifndef CHUNK_TRACE_LEVEL
+#define CHUNK_TRACE_LEVEL 1
+#endif
+
+#define CHUNK_TRACE_ENABLED (UE_TRACE_ENABLED && CHUNK_TRACE_LEVEL > 0)
+
+/**
+ * Every event and scope of the pipeline goes through this channel, enable it with
+ * -trace=cpu,counters,ChunkPipeline
+ */
+UE_TRACE_CHANNEL_EXTERN(ChunkPipelineChannel, MULTITHREADTEST_API)
+
+#if CHUNK_TRACE_ENABLED
+#define CHUNK_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, ChunkPipelineChannel)
+#else
+#define CHUNK_TRACE_SCOPE(Name)
+#endif
+
+#if CHUNK_TRACE_ENABLED && CHUNK_TRACE_LEVEL >= 2
+#define CHUNK_TRACE_SECTION_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, ChunkPipelineChannel)
+#else
+#define CHUNK_TRACE_SECTION_SCOPE(Name)
+#endif
+
+#if CHUNK_TRACE_LEVEL >= 3
+#define CHUNK_VOXEL_CYCLE_COUNTER(Stat) SCOPE_CYCLE_COUNTER(Stat)
+#else
+#define CHUNK_VOXEL_CYCLE_COUNTER(Stat)
+#endif
+
+/**
+ * Events of the chunk pipeline, every timestamp is FPlatformTime::Cycles64 so they line up
+ * with the CPU scopes.
+ *
+ * Columns are followed by position: the time spent in CreateColumnQueue is between
+ * ColumnProduced and ColumnStaged of the same column.
+ */
+struct MULTITHREADTEST_API FChunkTrace
+{
+	/**
+	 * A worker took a job, WaitCycles since it was put in the queue
+	 */
+	static void JobDequeued(const FColumnJob& Job, uint64 WaitCycles);
+
+	/**
+	 * A worker pushed a generated column to the game thread
+	 */
+	static void ColumnProduced(const FIntVector2& ColumnPos);
+
+	/**
+	 * The game thread took a column out of CreateColumnQueue
+	 */
+	static void ColumnStaged(const FIntVector2& ColumnPos);
+
+	/**
+	 * The game thread registered a column, LatencyCycles since its load was dispatched
+	 */
+	static void ColumnIntegrated(const FIntVector2& ColumnPos, uint64 LatencyCycles);
+
+	/**
+	 * Sampled once per frame, also shown as counters
+	 */
+	static void QueueDepths(int32 JobQueue, int32 CreateColumnQueue, int32 MeshQueue, int32 Staged);
+
+	/**
+	 * The calling worker finished waiting for jobs, after IdleCycles
+	 */
+	static void WorkerIdle(uint64 IdleCycles);
+};
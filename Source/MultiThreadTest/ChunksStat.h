@@ -12,6 +12,32 @@ DECLARE_CYCLE_STAT(TEXT("Gen Chunk Data XY"), STAT_GenerateChunkGenXY, STATGROUP
 DECLARE_CYCLE_STAT(TEXT("Set Data"), STAT_GenerateChunkSet, STATGROUP_CHUNKS);
 DECLARE_CYCLE_STAT(TEXT("Set Chunk Data"), STAT_SetChunkData, STATGROUP_CHUNKS);
 
+DECLARE_CYCLE_STAT(TEXT("Region Load Column"), STAT_RegionLoad, STATGROUP_CHUNKS);
+DECLARE_CYCLE_STAT(TEXT("Region Save Column"), STAT_RegionSave, STATGROUP_CHUNKS);
+DECLARE_CYCLE_STAT(TEXT("Region Flush"), STAT_RegionFlush, STATGROUP_CHUNKS);
+DECLARE_MEMORY_STAT(TEXT("Region Unwritten Columns"), STAT_RegionSavedMemory, STATGROUP_CHUNKS);
+
+DECLARE_CYCLE_STAT(TEXT("Integrate Columns"), STAT_IntegrateColumns, STATGROUP_CHUNKS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Integrate Backlog"), STAT_IntegrateBacklog, STATGROUP_CHUNKS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Integrated Columns"), STAT_IntegratedColumns, STATGROUP_CHUNKS);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Integrate Cost Per Column (ms)"), STAT_IntegrateCostMs,
+                           STATGROUP_CHUNKS);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Integrate Budget Used (%)"), STAT_IntegrateBudgetUsed,
+                           STATGROUP_CHUNKS);
+
+DECLARE_MEMORY_STAT(TEXT("Column Data"), STAT_ChunkColumnMemory, STATGROUP_CHUNKS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Registered Columns"), STAT_ChunkRegisteredColumns, STATGROUP_CHUNKS);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Bytes Per Column"), STAT_ChunkBytesPerColumn, STATGROUP_CHUNKS);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Spans Per Section"), STAT_ChunkSpansPerSection, STATGROUP_CHUNKS);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Compression Ratio (dense / actual)"), STAT_ChunkCompressionRatio,
+                           STATGROUP_CHUNKS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Column Copies"), STAT_ChunkColumnCopies, STATGROUP_CHUNKS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Section Copies"), STAT_ChunkSectionCopies, STATGROUP_CHUNKS);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Column Copies Per Column"), STAT_ChunkColumnCopiesPerColumn,
+                           STATGROUP_CHUNKS);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Section Copies Per Column"), STAT_ChunkSectionCopiesPerColumn,
+                           STATGROUP_CHUNKS);
+
 DECLARE_CYCLE_STAT(TEXT("ChunkRegistry Register Chunk"), STAT_ChunkRegistryRegisterChunk,
                    STATGROUP_CHUNKS);
 DECLARE_CYCLE_STAT(TEXT("ChunkRegistry On Column Spawn"), STAT_ChunkRegistryColumnSpawn,
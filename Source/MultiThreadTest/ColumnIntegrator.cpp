@@ -0,0 +1,90 @@
+﻿#include "ColumnIntegrator.h"
+
+#include "ChunksStat.h"
+#include "ChunkTrace.h"
+#include "Constants/GameConstants.h"
+
+int32 FColumnIntegrator::Tick(TMpmcQueue<FChunkDataColumn>& Queue, const FIntVector2& PlayerColumn,
+                              const float BudgetMs,
+                              const TFunctionRef<bool(const FChunkDataColumn&)> IsWanted,
+                              const TFunctionRef<void(FChunkDataColumn&&)> Integrate)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IntegrateColumns);
+	CHUNK_TRACE_SCOPE(ChunkIntegrateColumns);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = BudgetMs / 1000.0;
+
+	if (const int32 Available = Queue.Num())
+	{
+		const int32 FirstNew = Staged.Num();
+		Queue.DequeueMany(Staged, Available);
+		for (int32 Idx = FirstNew; Idx < Staged.Num(); Idx++)
+		{
+			FChunkTrace::ColumnStaged(Staged[Idx].ColumnPos);
+		}
+	}
+
+	// Evicted while the workers had them, or dispatched again since. Checked every tick, a
+	// staged column can become stale while it waits
+	for (int32 Idx = Staged.Num() - 1; Idx >= 0; Idx--)
+	{
+		if (!IsWanted(Staged[Idx]))
+		{
+			Staged.RemoveAtSwap(Idx, 1, EAllowShrinking::No);
+		}
+	}
+
+	Order.Reset();
+	for (int32 Idx = 0; Idx < Staged.Num(); Idx++)
+	{
+		const FIntVector2& ColumnPos = Staged[Idx].ColumnPos;
+		const int32 Distance = FMath::Max(FMath::Abs(ColumnPos.X - PlayerColumn.X),
+		                                  FMath::Abs(ColumnPos.Y - PlayerColumn.Y));
+		Order.Emplace(Distance, Idx);
+	}
+
+	Order.Sort([](const TPair<int32, int32>& A, const TPair<int32, int32>& B)
+	{
+		return A.Key < B.Key;
+	});
+
+	const int32 MaxCount = EstimatedCostSeconds > 0 ? Order.Num() : FGameConstants::CreateChunkPerTick;
+	Integrated.Reset();
+
+	double Elapsed = FPlatformTime::Seconds() - StartTime;
+	for (const auto& [Distance, Idx] : Order)
+	{
+		if (Integrated.Num() >= MaxCount ||
+			(Integrated.Num() > 0 && Elapsed + EstimatedCostSeconds > Budget))
+		{
+			break;
+		}
+
+		const double ItemStart = FPlatformTime::Seconds();
+		Integrate(MoveTemp(Staged[Idx]));
+		const double ItemEnd = FPlatformTime::Seconds();
+
+		const double Cost = ItemEnd - ItemStart;
+		EstimatedCostSeconds = EstimatedCostSeconds > 0
+			                       ? FMath::Lerp(EstimatedCostSeconds, Cost, CostSmoothing)
+			                       : Cost;
+
+		Elapsed = ItemEnd - StartTime;
+		Integrated.Add(Idx);
+	}
+
+	// Highest index first, so swapping the last column in doesn't move one still to remove
+	Integrated.Sort(TGreater<int32>());
+	for (const int32 Idx : Integrated)
+	{
+		Staged.RemoveAtSwap(Idx, 1, EAllowShrinking::No);
+	}
+
+	SET_DWORD_STAT(STAT_IntegrateBacklog, Staged.Num() + Queue.Num());
+	SET_DWORD_STAT(STAT_IntegratedColumns, Integrated.Num());
+	SET_FLOAT_STAT(STAT_IntegrateCostMs, GetEstimatedCostMs());
+	SET_FLOAT_STAT(STAT_IntegrateBudgetUsed, Budget > 0 ? Elapsed / Budget * 100 : 0);
+
+	return Integrated.Num();
+}
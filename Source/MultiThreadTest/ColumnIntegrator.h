@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ChunkDataColumn.h"
+#include "MpmcQueue.h"
+
+/**
+ * Game thread side of CreateColumnQueue: takes what the workers produced and integrates as
+ * many columns as fit in a per frame time budget, nearest to the player first.
+ *
+ * Everything available is moved out of the queue into a staging array every tick (a move
+ * per column), so the workers never stall on a full queue because the game thread is behind.
+ * The cost of one integration is tracked as a moving average of what was measured, and a
+ * column is only started when the average still fits in what's left of the budget. At least
+ * one column is integrated per tick so the backlog always moves, and until the first
+ * measurement at most CreateChunkPerTick are.
+ */
+class FColumnIntegrator
+{
+public:
+	/**
+	 * Stage new results, drop the ones IsWanted rejects, then integrate the nearest ones
+	 * within BudgetMs. Returns how many were integrated
+	 */
+	int32 Tick(TMpmcQueue<FChunkDataColumn>& Queue, const FIntVector2& PlayerColumn,
+	           float BudgetMs, TFunctionRef<bool(const FChunkDataColumn&)> IsWanted,
+	           TFunctionRef<void(FChunkDataColumn&&)> Integrate);
+
+	/**
+	 * Columns received and not integrated yet
+	 */
+	int32 NumStaged() const
+	{
+		return Staged.Num();
+	}
+
+	/**
+	 * Moving average of one integration, 0 before the first one
+	 */
+	double GetEstimatedCostMs() const
+	{
+		return EstimatedCostSeconds * 1000;
+	}
+
+private:
+	/**
+	 * Weight of the last measurement in the moving average
+	 */
+	static constexpr double CostSmoothing = 0.2;
+
+	TArray<FChunkDataColumn> Staged;
+
+	/**
+	 * Staged indices nearest first, rebuilt every tick
+	 */
+	TArray<TPair<int32, int32>> Order;
+
+	TArray<int32> Integrated;
+
+	double EstimatedCostSeconds = 0;
+};
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Constants/GameConstants.h"
+#include <atomic>
+
+/**
+ * What a worker can be asked to do with a column
+ */
+enum class EColumnJobKind : uint8
+{
+	/**
+	 * Load or generate the column at Resolution, dispatched by FColumnLoadScheduler
+	 */
+	Generate,
+
+	/**
+	 * Mesh every section of a registered column against its side neighbors, released by
+	 * FColumnJobGraph once they are all there
+	 */
+	Mesh,
+};
+
+/**
+ * One item of the worker queue
+ */
+struct FColumnJob
+{
+	EColumnJobKind Kind = EColumnJobKind::Generate;
+
+	FIntVector2 ColumnPos;
+
+	/**
+	 * Generate only. Resolution of the sections, picked from the distance to the player when
+	 * dispatched
+	 */
+	uint8 Resolution = FGameConstants::ChunkSize;
+
+	/**
+	 * FPlatformTime::Cycles64 when it was put in the queue, the worker taking it measures how
+	 * long it waited
+	 */
+	uint64 EnqueueCycles = 0;
+};
+
+/**
+ * How many jobs of each kind sit in the worker queue. Both kinds share the queue so a parked
+ * worker wakes up for either, this lets each dispatcher top up its own kind against its own
+ * depth budget instead of the queue's total. Dispatchers add, the worker taking a job removes
+ */
+class FColumnJobDepths
+{
+public:
+	void Add(const EColumnJobKind Kind, const int32 Count = 1)
+	{
+		Depths[static_cast<uint8>(Kind)].fetch_add(Count, std::memory_order_relaxed);
+	}
+
+	void Remove(const EColumnJobKind Kind)
+	{
+		Depths[static_cast<uint8>(Kind)].fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	int32 Num(const EColumnJobKind Kind) const
+	{
+		return Depths[static_cast<uint8>(Kind)].load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<int32> Depths[2] = {};
+};
@@ -0,0 +1,113 @@
+﻿#include "ColumnJobGraph.h"
+
+#include "ChunkHelper.h"
+#include "ChunkRegistry.h"
+
+FColumnJobGraph::FColumnJobGraph(const UChunkRegistry* InRegistry) : Registry(InRegistry)
+{
+	check(Registry);
+}
+
+void FColumnJobGraph::OnColumnRegistered(const FIntVector2& ColumnPos)
+{
+	check(IsInGameThread());
+
+	Evaluate(ColumnPos);
+
+	// Their border with this column changed
+	for (const auto& NeighborPos : UChunkHelper::GetNeighborPositions(ColumnPos))
+	{
+		if (Registry->FindData(NeighborPos))
+		{
+			Evaluate(NeighborPos);
+		}
+	}
+}
+
+void FColumnJobGraph::OnColumnRemoved(const FIntVector2& ColumnPos)
+{
+	check(IsInGameThread());
+
+	Released.Remove(ColumnPos);
+	Waiting.Remove(ColumnPos);
+
+	// Not tracked anymore means not waited on anymore
+	for (const auto& NeighborPos : UChunkHelper::GetNeighborPositions(ColumnPos))
+	{
+		if (Waiting.Contains(NeighborPos))
+		{
+			Evaluate(NeighborPos);
+		}
+	}
+}
+
+int32 FColumnJobGraph::Dispatch(TMpmcQueue<FColumnJob>& Queue, FColumnJobDepths& Depths,
+                               const int32 MaxJobs,
+                               const TFunctionRef<int32(const FIntVector2&)> Distance)
+{
+	if (MaxJobs <= 0 || Released.IsEmpty())
+	{
+		return 0;
+	}
+
+	Order.Reset();
+	for (const FIntVector2& ColumnPos : Released)
+	{
+		Order.Emplace(Distance(ColumnPos), ColumnPos);
+	}
+
+	Order.Sort([](const TPair<int32, FIntVector2>& A, const TPair<int32, FIntVector2>& B)
+	{
+		return A.Key < B.Key;
+	});
+
+	int32 Dispatched = 0;
+	for (const auto& [ColumnDistance, ColumnPos] : Order)
+	{
+		if (Dispatched >= MaxJobs)
+		{
+			break;
+		}
+
+		FColumnJob Job{EColumnJobKind::Mesh, ColumnPos};
+		Depths.Add(EColumnJobKind::Mesh);
+		Job.EnqueueCycles = FPlatformTime::Cycles64();
+		if (!Queue.Enqueue(Job))
+		{
+			Depths.Remove(EColumnJobKind::Mesh);
+			break;
+		}
+
+		Released.Remove(ColumnPos);
+		Dispatched++;
+	}
+
+	return Dispatched;
+}
+
+void FColumnJobGraph::Evaluate(const FIntVector2& ColumnPos)
+{
+	if (AreNeighborsReady(ColumnPos))
+	{
+		Waiting.Remove(ColumnPos);
+		Released.Add(ColumnPos);
+	}
+	else
+	{
+		Waiting.Add(ColumnPos);
+	}
+}
+
+bool FColumnJobGraph::AreNeighborsReady(const FIntVector2& ColumnPos) const
+{
+	for (const auto& NeighborPos : UChunkHelper::GetNeighborPositions(ColumnPos))
+	{
+		FRegisteredColumn Neighbor;
+		if (Registry->Find(NeighborPos, Neighbor) && !Neighbor.Data)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ColumnJob.h"
+#include "MpmcQueue.h"
+
+class UChunkRegistry;
+
+/**
+ * Game thread side of the jobs that need a column and its four side neighbors
+ * (UChunkHelper::GetNeighborPositions), meshing so far.
+ *
+ * Driven by registry changes, nothing is polled: when a column is registered its own job
+ * and the ones of its registered neighbors are re-evaluated, when one is removed only the
+ * neighbors waiting on it are. A job is released once the column has data and every
+ * neighbor either has data too or isn't tracked by the registry at all (outside of the
+ * streamed area, it will never come). Columns registered again (regenerated, or another
+ * resolution) release their neighbors again, so the seams follow.
+ *
+ * A released job is dispatched once however many times it was released meanwhile, and reads
+ * the latest data from the registry when it runs.
+ */
+class FColumnJobGraph
+{
+public:
+	explicit FColumnJobGraph(const UChunkRegistry* InRegistry);
+
+	/**
+	 * Data was registered for the column, for the first time or not
+	 */
+	void OnColumnRegistered(const FIntVector2& ColumnPos);
+
+	/**
+	 * The column was removed from the registry
+	 */
+	void OnColumnRemoved(const FIntVector2& ColumnPos);
+
+	/**
+	 * Hand up to MaxJobs released jobs to the workers, lowest Distance first, returns how many
+	 * were enqueued. What doesn't fit stays released for the next call
+	 */
+	int32 Dispatch(TMpmcQueue<FColumnJob>& Queue, FColumnJobDepths& Depths, int32 MaxJobs,
+	               TFunctionRef<int32(const FIntVector2&)> Distance);
+
+	int32 NumReleased() const
+	{
+		return Released.Num();
+	}
+
+	/**
+	 * Columns with data whose neighbors aren't all there yet
+	 */
+	int32 NumWaiting() const
+	{
+		return Waiting.Num();
+	}
+
+private:
+	/**
+	 * Release the job of a column that has data, or park it until its neighbors are ready
+	 */
+	void Evaluate(const FIntVector2& ColumnPos);
+
+	bool AreNeighborsReady(const FIntVector2& ColumnPos) const;
+
+	const UChunkRegistry* Registry;
+
+	TSet<FIntVector2> Released;
+
+	TSet<FIntVector2> Waiting;
+
+	/**
+	 * Released jobs by distance, rebuilt by every Dispatch
+	 */
+	TArray<TPair<int32, FIntVector2>> Order;
+};
@@ -0,0 +1,131 @@
+﻿#include "ColumnLoadScheduler.h"
+
+#include "ChunkHelper.h"
+
+int32 FColumnLoadScheduler::SetPlayerPosition(const FVector& Position)
+{
+	const auto NewPlayerColumn = UChunkHelper::ToChunkPos(Position);
+	if (NewPlayerColumn == PlayerColumn)
+	{
+		return 0;
+	}
+
+	PlayerColumn = NewPlayerColumn;
+	Epoch++;
+
+	int32 Requeued = 0;
+	for (const auto& [ColumnPos, Resolution] : LoadedResolutions)
+	{
+		if (Resolution != GetWantedResolution(ColumnPos) && Add(ColumnPos))
+		{
+			Requeued++;
+		}
+	}
+
+	return Requeued;
+}
+
+bool FColumnLoadScheduler::Add(const FIntVector2& ColumnPos)
+{
+	bool bAlreadyPending;
+	Pending.Add(ColumnPos, &bAlreadyPending);
+	if (bAlreadyPending)
+	{
+		return false;
+	}
+
+	Heap.HeapPush(FEntry{ColumnPos, DistanceTo(ColumnPos), Epoch}, FNearestFirst());
+	return true;
+}
+
+bool FColumnLoadScheduler::Remove(const FIntVector2& ColumnPos)
+{
+	return Pending.Remove(ColumnPos) > 0;
+}
+
+bool FColumnLoadScheduler::Pop(FColumnJob& OutJob)
+{
+	while (Heap.Num())
+	{
+		FEntry Top;
+		Heap.HeapPop(Top, FNearestFirst());
+
+		// Removed (or re-added, and this is the older entry)
+		if (!Pending.Contains(Top.ColumnPos))
+		{
+			continue;
+		}
+
+		if (Top.Epoch != Epoch)
+		{
+			Top.Distance = DistanceTo(Top.ColumnPos);
+			Top.Epoch = Epoch;
+			Heap.HeapPush(Top, FNearestFirst());
+			continue;
+		}
+
+		Pending.Remove(Top.ColumnPos);
+
+		// Queued for another resolution, and the player came back before it was dispatched
+		const uint8 Resolution = UChunkHelper::GetLoDResolutionPerDistance(Top.Distance);
+		const uint8* LoadedResolution = LoadedResolutions.Find(Top.ColumnPos);
+		if (LoadedResolution && *LoadedResolution == Resolution)
+		{
+			continue;
+		}
+
+		OutJob = FColumnJob{EColumnJobKind::Generate, Top.ColumnPos, Resolution};
+		return true;
+	}
+
+	return false;
+}
+
+int32 FColumnLoadScheduler::Dispatch(TMpmcQueue<FColumnJob>& Queue, FColumnJobDepths& Depths,
+                                     const int32 TargetDepth)
+{
+	int32 Dispatched = 0;
+	FColumnJob Job;
+	while (Depths.Num(EColumnJobKind::Generate) < TargetDepth && Pop(Job))
+	{
+		// Counted before the enqueue, the worker taking it removes it
+		Depths.Add(EColumnJobKind::Generate);
+		Job.EnqueueCycles = FPlatformTime::Cycles64();
+		if (!Queue.Enqueue(Job))
+		{
+			Depths.Remove(EColumnJobKind::Generate);
+			Add(Job.ColumnPos);
+			break;
+		}
+
+		InFlight.Add(Job.ColumnPos, Job.EnqueueCycles);
+		Dispatched++;
+	}
+
+	return Dispatched;
+}
+
+void FColumnLoadScheduler::MarkLoaded(const FIntVector2& ColumnPos, const uint8 Resolution)
+{
+	InFlight.Remove(ColumnPos);
+	LoadedResolutions.Add(ColumnPos, Resolution);
+
+	// Dispatched before the player changed column, SetPlayerPosition only requeued what was
+	// loaded then
+	if (Resolution != GetWantedResolution(ColumnPos))
+	{
+		Add(ColumnPos);
+	}
+}
+
+void FColumnLoadScheduler::MarkUnloaded(const FIntVector2& ColumnPos)
+{
+	Pending.Remove(ColumnPos);
+	InFlight.Remove(ColumnPos);
+	LoadedResolutions.Remove(ColumnPos);
+}
+
+uint8 FColumnLoadScheduler::GetWantedResolution(const FIntVector2& ColumnPos) const
+{
+	return UChunkHelper::GetLoDResolutionPerDistance(DistanceTo(ColumnPos));
+}
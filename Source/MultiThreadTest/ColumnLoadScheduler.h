@@ -0,0 +1,146 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ColumnJob.h"
+#include "MpmcQueue.h"
+#include "Constants/GameConstants.h"
+
+/**
+ * Game thread priority queue of the columns waiting to be generated, nearest to the player
+ * first (Chebyshev ring distance, see UChunkHelper::ChunkDistanceToPosition).
+ *
+ * Only a shallow window is handed to the workers at a time (Dispatch), so the order of
+ * everything still pending follows the player as it moves.
+ *
+ * Moving doesn't rebuild the heap: it bumps an epoch, and entries keyed in an older epoch
+ * get their distance recomputed and are pushed back when they reach the top. A pending
+ * column can therefore come out at most one ring late per column the player moved since
+ * it was keyed, until it reaches the top and gets re-keyed.
+ *
+ * The resolution of a column follows its distance (UChunkHelper::GetLoDResolutionPerDistance).
+ * Loaded columns are tracked with their resolution, and when the player changes column the
+ * ones now wanted at another resolution are queued again, nothing else is touched.
+ */
+class FColumnLoadScheduler
+{
+public:
+	/**
+	 * Returns how many loaded columns were queued again for another resolution
+	 */
+	int32 SetPlayerPosition(const FVector& Position);
+
+	/**
+	 * Returns false if the column was already pending
+	 */
+	bool Add(const FIntVector2& ColumnPos);
+
+	/**
+	 * Drop a pending column, its heap entry is discarded lazily
+	 */
+	bool Remove(const FIntVector2& ColumnPos);
+
+	/**
+	 * Generate job of the nearest pending column, with the resolution it should have now.
+	 * Columns already loaded at that resolution are skipped
+	 */
+	bool Pop(FColumnJob& OutJob);
+
+	/**
+	 * Top up the queue with the nearest pending columns until it holds TargetDepth generate
+	 * jobs, returns how many were handed out. Mesh jobs sharing the queue don't count
+	 */
+	int32 Dispatch(TMpmcQueue<FColumnJob>& Queue, FColumnJobDepths& Depths, int32 TargetDepth);
+
+	/**
+	 * Record a column the workers produced, so it can be upgraded or downgraded later. Queued
+	 * again right away if the player moved since and it isn't at the wanted resolution
+	 */
+	void MarkLoaded(const FIntVector2& ColumnPos, uint8 Resolution);
+
+	/**
+	 * Forget a column whatever its state: pending, handed to the workers or loaded
+	 */
+	void MarkUnloaded(const FIntVector2& ColumnPos);
+
+	uint8 GetWantedResolution(const FIntVector2& ColumnPos) const;
+
+	/**
+	 * Ring distance to the player column, what everything is prioritized by
+	 */
+	int32 DistanceTo(const FIntVector2& ColumnPos) const
+	{
+		return FMath::Max(FMath::Abs(ColumnPos.X - PlayerColumn.X),
+		                  FMath::Abs(ColumnPos.Y - PlayerColumn.Y));
+	}
+
+	int32 Num() const
+	{
+		return Pending.Num();
+	}
+
+	bool IsPending(const FIntVector2& ColumnPos) const
+	{
+		return Pending.Contains(ColumnPos);
+	}
+
+	/**
+	 * Dispatched and not back yet
+	 */
+	bool IsInFlight(const FIntVector2& ColumnPos) const
+	{
+		return InFlight.Contains(ColumnPos);
+	}
+
+	/**
+	 * FPlatformTime::Cycles64 when the column was dispatched, 0 if it isn't in flight
+	 */
+	uint64 GetDispatchCycles(const FIntVector2& ColumnPos) const
+	{
+		const uint64* Cycles = InFlight.Find(ColumnPos);
+		return Cycles ? *Cycles : 0;
+	}
+
+	bool IsLoaded(const FIntVector2& ColumnPos) const
+	{
+		return LoadedResolutions.Contains(ColumnPos);
+	}
+
+	int32 NumLoaded() const
+	{
+		return LoadedResolutions.Num();
+	}
+
+private:
+	struct FEntry
+	{
+		FIntVector2 ColumnPos;
+
+		int32 Distance;
+
+		uint32 Epoch;
+	};
+
+	struct FNearestFirst
+	{
+		bool operator()(const FEntry& A, const FEntry& B) const
+		{
+			return A.Distance < B.Distance;
+		}
+	};
+
+	TArray<FEntry> Heap;
+
+	TSet<FIntVector2> Pending;
+
+	/**
+	 * Dispatched columns, with the FPlatformTime::Cycles64 they were dispatched at. The job
+	 * carries it too (FColumnJob::EnqueueCycles), so a result can be matched to its dispatch
+	 */
+	TMap<FIntVector2, uint64> InFlight;
+
+	TMap<FIntVector2, uint8> LoadedResolutions;
+
+	FIntVector2 PlayerColumn{0, 0};
+
+	uint32 Epoch = 0;
+};
@@ -0,0 +1,66 @@
+﻿#include "ColumnStreamer.h"
+
+#include "ChunkHelper.h"
+#include "ColumnLoadScheduler.h"
+
+FColumnStreamer::FColumnStreamer(const int32 InLoadDistance, const int32 InUnloadDistance)
+	: LoadDistance(InLoadDistance), UnloadDistance(InUnloadDistance)
+{
+	checkf(LoadDistance >= 0 && LoadDistance <= UnloadDistance,
+	       TEXT("Invalid streaming distances %d/%d"), LoadDistance, UnloadDistance);
+}
+
+bool FColumnStreamer::Update(const FVector& PlayerPosition, FColumnLoadScheduler& Scheduler,
+                             TArray<FIntVector2>& OutEntered,
+                             TArray<FIntVector2>& OutEvicted)
+{
+	const auto NewPlayerColumn = UChunkHelper::ToChunkPos(PlayerPosition);
+	if (PlayerColumn.IsSet() && *PlayerColumn == NewPlayerColumn)
+	{
+		return false;
+	}
+
+	// Whatever the scheduler knows about lies within UnloadDistance of the old column, so
+	// the strip leaving that square is all there is to evict
+	if (PlayerColumn.IsSet())
+	{
+		UChunkHelper::ForEachPositionEntering(
+			*PlayerColumn, UnloadDistance, NewPlayerColumn, UnloadDistance,
+			[&Scheduler, &OutEvicted](const FIntVector2& ColumnPos)
+			{
+				if (Scheduler.IsPending(ColumnPos) || Scheduler.IsInFlight(ColumnPos) ||
+					Scheduler.IsLoaded(ColumnPos))
+				{
+					OutEvicted.Add(ColumnPos);
+				}
+
+				Scheduler.MarkUnloaded(ColumnPos);
+			});
+	}
+
+	// Re-keys the pending columns and requeues the loaded ones for their new LoD, after the
+	// eviction so nothing leaving gets requeued
+	Scheduler.SetPlayerPosition(PlayerPosition);
+
+	// Columns kept in the hysteresis band come back in range already loaded
+	UChunkHelper::ForEachPositionEntering(
+		NewPlayerColumn, LoadDistance, PlayerColumn, LoadDistance,
+		[&Scheduler, &OutEntered](const FIntVector2& ColumnPos)
+		{
+			if (!Scheduler.IsLoaded(ColumnPos) && !Scheduler.IsInFlight(ColumnPos) &&
+				Scheduler.Add(ColumnPos))
+			{
+				OutEntered.Add(ColumnPos);
+			}
+		});
+
+	PlayerColumn = NewPlayerColumn;
+	return true;
+}
+
+bool FColumnStreamer::IsInRange(const FIntVector2& ColumnPos) const
+{
+	return PlayerColumn.IsSet() &&
+		FMath::Max(FMath::Abs(ColumnPos.X - PlayerColumn->X),
+		           FMath::Abs(ColumnPos.Y - PlayerColumn->Y)) <= UnloadDistance;
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Constants/GameConstants.h"
+
+class FColumnLoadScheduler;
+
+/**
+ * Game thread bookkeeping of which columns should exist around the player.
+ *
+ * When the player changes column, only the strips between the old and the new square are
+ * visited (UChunkHelper::ForEachPositionEntering): the columns entering LoadDistance are added
+ * to the scheduler, the ones leaving UnloadDistance are forgotten. UnloadDistance is larger
+ * than LoadDistance, columns in between are kept but never requested, so jittering over a
+ * border doesn't load and unload the same ring again and again.
+ */
+class FColumnStreamer
+{
+public:
+	explicit FColumnStreamer(
+		int32 InLoadDistance = FGameConstants::DefaultUnloadedDistance - FGameConstants::StreamingHysteresis,
+		int32 InUnloadDistance = FGameConstants::DefaultUnloadedDistance);
+
+	/**
+	 * Follow the player, returns false while it stays in the same column. The columns newly
+	 * added to the scheduler are appended to OutEntered, the ones the scheduler knew about
+	 * (pending, in flight or loaded) and are now too far to OutEvicted
+	 */
+	bool Update(const FVector& PlayerPosition, FColumnLoadScheduler& Scheduler,
+	            TArray<FIntVector2>& OutEntered, TArray<FIntVector2>& OutEvicted);
+
+	/**
+	 * Whether a column is still wanted, columns coming back from the workers after being
+	 * evicted should be dropped
+	 */
+	bool IsInRange(const FIntVector2& ColumnPos) const;
+
+	const TOptional<FIntVector2>& GetPlayerColumn() const
+	{
+		return PlayerColumn;
+	}
+
+private:
+	int32 LoadDistance;
+
+	int32 UnloadDistance;
+
+	/**
+	 * Unset until the first update
+	 */
+	TOptional<FIntVector2> PlayerColumn;
+};
@@ -17,20 +17,43 @@ struct FGameConstants
 
 	static constexpr int32 ScaleMultiplier = 100;
 
-	static constexpr int16 DefaultLiveDistance = 12;
-	static constexpr int16 DefaultLoD8Distance = 12;
-	static constexpr int16 DefaultLoD4Distance = 12;
-	static constexpr int16 DefaultLoD2Distance = 12;
+	static constexpr int16 DefaultLiveDistance = 4;
+	static constexpr int16 DefaultLoD8Distance = 6;
+	static constexpr int16 DefaultLoD4Distance = 8;
+	static constexpr int16 DefaultLoD2Distance = 10;
 	static constexpr int16 DefaultLoD1Distance = 12;
 	static constexpr int16 DefaultUnloadedDistance = 13;
 
+	/**
+	 * Columns are loaded up to DefaultUnloadedDistance - StreamingHysteresis and only unloaded
+	 * past DefaultUnloadedDistance, so walking back and forth over a column border doesn't
+	 * load and unload the same ring every time
+	 */
+	static constexpr int16 StreamingHysteresis = 1;
+
 	static constexpr float ChunksManagerTickInterval = 1.0f;
 
 	static constexpr int ChunkRenderingThreads = 24;
 
+	static constexpr int LoadQueueDepthPerWorker = 2;
+
+	/**
+	 * Mesh jobs waiting in the worker queue per worker, on top of the generate jobs
+	 */
+	static constexpr int MeshQueueDepthPerWorker = 1;
+
 	static constexpr float InteractionDistance = 1000.f;
 
 	static constexpr int CreateChunkPerTick = 10;
-	static constexpr int RenderChunkPerTick = 10;
+
+	/**
+	 * Game thread time spent integrating generated columns per frame
+	 */
+	static constexpr float IntegrationBudgetMs = 2.f;
+
+	/**
+	 * Game thread time spent taking section meshes from the workers per frame
+	 */
+	static constexpr float MeshDrainBudgetMs = 1.f;
 	static constexpr int CheckIsReadyToRenderPerLazyTick = 100;
 };
@@ -1,54 +1,205 @@
 ﻿#include "LoadChunkRunnable.h"
 
 #include "ChunkDataColumn.h"
+#include "ChunkMesher.h"
+#include "ChunkRegistry.h"
 #include "ChunksStat.h"
+#include "ChunkTrace.h"
 #include "WorldGenerator.h"
+#include "Structs/HierarchicalDownsampler.h"
 #include "Constants/GameConstants.h"
 
 struct FRenderData;
 
+FLoadChunkRunnable::FLoadChunkRunnable(
+	UWorldGenerator* InWorldGenerator,
+	const TSharedPtr<TMpmcQueue<FColumnJob>>& InJobQueue,
+	const TSharedPtr<FColumnJobDepths>& InJobDepths,
+	const TSharedPtr<TMpmcQueue<FChunkDataColumn>>& InCreateColumnQueue,
+	const TSharedPtr<FRegionStore>& InRegionStore,
+	const TSharedPtr<TMpmcQueue<FChunkMesh>>& InMeshQueue,
+	UChunkRegistry* InChunkRegistry):
+	WorldGenerator(InWorldGenerator),
+	Noise(InWorldGenerator->CreateNoise()),
+	JobQueue(InJobQueue),
+	JobDepths(InJobDepths),
+	CreateColumnQueue(InCreateColumnQueue),
+	RegionStore(InRegionStore),
+	MeshQueue(InMeshQueue),
+	ChunkRegistry(InChunkRegistry),
+	WakeEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+}
+
 uint32 FLoadChunkRunnable::Run()
 {
 	while (StopTaskCounter.GetValue() == 0)
 	{
-		LoadColumnQueue->CriticalSection.Lock();
-		if (LoadColumnQueue.Get()->IsEmptyWithoutLock())
+		FColumnJob Job;
+		if (!JobQueue->Dequeue(Job))
 		{
-			LoadColumnQueue->CriticalSection.Unlock();
-			FPlatformProcess::Sleep(0.01f);
+			const uint64 IdleStart = FPlatformTime::Cycles64();
+			{
+				CHUNK_TRACE_SCOPE(ChunkWorkerIdle);
+				JobQueue->WaitForItems(WakeEvent);
+			}
+
+			const uint64 IdleCycles = FPlatformTime::Cycles64() - IdleStart;
+			Stats.IdleCycles.fetch_add(IdleCycles, std::memory_order_relaxed);
+			FChunkTrace::WorkerIdle(IdleCycles);
 			continue;
 		}
 
+		if (JobDepths)
 		{
-			SCOPE_CYCLE_COUNTER(STAT_GenerateChunk);
+			JobDepths->Remove(Job.Kind);
+		}
 
-			auto ColumnPosOpt = LoadColumnQueue.Get()->DequeueSafeWithoutLock();
-			LoadColumnQueue->CriticalSection.Unlock();
+		const uint64 BusyStart = FPlatformTime::Cycles64();
+		const uint64 WaitCycles = Job.EnqueueCycles && BusyStart > Job.EnqueueCycles
+			                          ? BusyStart - Job.EnqueueCycles
+			                          : 0;
+		Stats.QueueWaitCycles.fetch_add(WaitCycles, std::memory_order_relaxed);
+		FChunkTrace::JobDequeued(Job, WaitCycles);
 
-			if (ColumnPosOpt.IsSet())
+		{
+			CHUNK_TRACE_SCOPE(ChunkWorkerJob);
+			switch (Job.Kind)
 			{
-				const auto ColumnPos = ColumnPosOpt.GetValue();
-				FChunkDataColumn ColumnData{ColumnPos};
-				for (int Z = 0; Z < FGameConstants::ChunksInZ; Z++)
-				{
-					TArray<FHierarchicalGrid> Grids;
-					WorldGenerator->Generate(ColumnPos, Grids);
-					ColumnData.ChunkDatas = MoveTemp(Grids);
-				}
-
-				CreateColumnQueue->CriticalSection.Lock();
-				CreateColumnQueue.Get()->EnqueueWithoutLock(MoveTemp(ColumnData));
-				CreateColumnQueue->CriticalSection.Unlock();
+			case EColumnJobKind::Generate:
+				GenerateColumn(Job);
+				break;
+			case EColumnJobKind::Mesh:
+				MeshColumn(Job.ColumnPos);
+				break;
 			}
 		}
 
-		FPlatformProcess::Sleep(0.01f);
+		Stats.BusyCycles.fetch_add(FPlatformTime::Cycles64() - BusyStart, std::memory_order_relaxed);
+		Stats.Jobs.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	return 0;
 }
 
+void FLoadChunkRunnable::GenerateColumn(const FColumnJob& Job) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_GenerateChunk);
+	CHUNK_TRACE_SCOPE(ChunkGenerateColumn);
+
+	SetState(Job.ColumnPos, EColumnState::Generating);
+
+	FChunkDataColumn ColumnData{Job.ColumnPos};
+	LoadColumn(Job, ColumnData);
+	ColumnData.DispatchCycles = Job.EnqueueCycles;
+	SetState(Job.ColumnPos, EColumnState::Generated);
+
+	// The game thread drains the results, wait for room if it fell behind. It registers the
+	// column, which releases the mesh jobs
+	FChunkTrace::ColumnProduced(Job.ColumnPos);
+	EnqueueOrWait(*CreateColumnQueue, MoveTemp(ColumnData));
+}
+
+void FLoadChunkRunnable::LoadColumn(const FColumnJob& Job, FChunkDataColumn& OutColumn) const
+{
+	const bool bFullResolution = Job.Resolution == FGameConstants::ChunkSize;
+	if (RegionStore && RegionStore->Load(Job.ColumnPos, OutColumn))
+	{
+		// The store only holds full resolution columns
+		if (!bFullResolution)
+		{
+			for (auto& Grid : OutColumn.ChunkDatas)
+			{
+				FHierarchicalGrid Downsampled;
+				FHierarchicalDownsampler::Downsample(Grid, Job.Resolution, Downsampled);
+				Grid = MoveTemp(Downsampled);
+			}
+
+			OutColumn.RebuildHeights();
+		}
+
+		return;
+	}
+
+	WorldGenerator->GenerateColumn(Job.ColumnPos, *Noise, OutColumn, Job.Resolution);
+	if (RegionStore && bFullResolution)
+	{
+		RegionStore->Save(OutColumn);
+	}
+}
+
+void FLoadChunkRunnable::MeshColumn(const FIntVector2& ColumnPos) const
+{
+	CHUNK_TRACE_SCOPE(ChunkMeshColumn);
+
+	if (!MeshQueue || !ChunkRegistry)
+	{
+		return;
+	}
+
+	// Evicted since the job was released
+	const FColumnDataPtr Column = ChunkRegistry->FindData(ColumnPos);
+	if (!Column)
+	{
+		return;
+	}
+
+	// Shared pointers, the columns stay alive even if they are replaced or evicted meanwhile
+	FColumnDataPtr Neighbors[4];
+	ChunkRegistry->FindNeighbors(ColumnPos, Neighbors);
+	const FChunkColumnSnapshot* SideColumns[4] = {
+		Neighbors[0].Get(), Neighbors[1].Get(), Neighbors[2].Get(), Neighbors[3].Get()
+	};
+
+	// Everything above the terrain is air, below it only borders can show
+	bool bMeshed = false;
+	const int32 EndSection = FMath::Min(Column->Heights.GetEndSection(), Column->NumSections());
+	for (int32 ChunkZ = 0; ChunkZ < EndSection; ChunkZ++)
+	{
+		if (!FChunkMesher::NeedsMesh(*Column, ChunkZ, SideColumns))
+		{
+			continue;
+		}
+
+		CHUNK_TRACE_SECTION_SCOPE(ChunkMeshSection);
+		auto Mesh = FChunkMeshData::Acquire();
+		FChunkMesher::BuildSection(*Column, ChunkZ, *Mesh, SideColumns);
+		if (Mesh->IsEmpty())
+		{
+			continue;
+		}
+
+		// Before the game thread can dequeue a mesh and set the column Live
+		if (!bMeshed)
+		{
+			SetState(ColumnPos, EColumnState::Meshed);
+			bMeshed = true;
+		}
+
+		// The job graph only dispatches while the queue has room for every section of the
+		// mesh jobs out there, this doesn't wait unless the game thread stopped draining
+		const FIntVector ChunkPos{ColumnPos.X, ColumnPos.Y, ChunkZ};
+		EnqueueOrWait(*MeshQueue, FChunkMesh{ChunkPos, MoveTemp(Mesh)});
+	}
+
+	// Nothing to show (all air, or buried), no mesh will bring it Live
+	if (!bMeshed)
+	{
+		SetState(ColumnPos, EColumnState::Live);
+	}
+}
+
+void FLoadChunkRunnable::SetState(const FIntVector2& ColumnPos, const EColumnState State) const
+{
+	// Columns evicted in the meantime aren't tracked anymore and stay that way
+	if (ChunkRegistry)
+	{
+		ChunkRegistry->SetState(ColumnPos, State);
+	}
+}
+
 void FLoadChunkRunnable::Stop()
 {
 	StopTaskCounter.Increment();
+	WakeEvent->Trigger();
 }
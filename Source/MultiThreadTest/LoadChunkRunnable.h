@@ -1,12 +1,39 @@
 ﻿#pragma once
 
 #include "ChunkDataColumn.h"
-#include "ThreadSafeQueue.h"
+#include "ChunkMeshData.h"
+#include "ColumnJob.h"
+#include "MpmcQueue.h"
+#include "RegionStore.h"
+#include "TerrainNoise.h"
+#include <atomic>
 
 class UWorldGenerator;
 class FLoadChunkRunnable;
 class AChunk;
 class UChunkRegistry;
+enum class EColumnState : uint8;
+
+/**
+ * Where a worker's time went, in FPlatformTime::Cycles64 units. Updated by the worker after
+ * every job and every wait, readable from any thread
+ */
+struct FLoadChunkWorkerStats
+{
+	std::atomic<uint64> BusyCycles{0};
+
+	/**
+	 * Parked in WaitForItems
+	 */
+	std::atomic<uint64> IdleCycles{0};
+
+	/**
+	 * Summed over the jobs taken, from their EnqueueCycles to the dequeue
+	 */
+	std::atomic<uint64> QueueWaitCycles{0};
+
+	std::atomic<uint32> Jobs{0};
+};
 
 struct FReturnData2
 {
@@ -26,8 +53,12 @@ class FLoadChunkRunnable : public FRunnable
 public:
 	static FReturnData2 Create(
 		UWorldGenerator* InWorldGenerator,
-		const TSharedPtr<TThreadSafeQueue<FIntVector2>>& InLoadColumnQueue,
-		const TSharedPtr<TThreadSafeQueue<FChunkDataColumn>>& InCreateColumnQueue,
+		const TSharedPtr<TMpmcQueue<FColumnJob>>& InJobQueue,
+		const TSharedPtr<FColumnJobDepths>& InJobDepths,
+		const TSharedPtr<TMpmcQueue<FChunkDataColumn>>& InCreateColumnQueue,
+		const TSharedPtr<FRegionStore>& InRegionStore,
+		const TSharedPtr<TMpmcQueue<FChunkMesh>>& InMeshQueue,
+		UChunkRegistry* InChunkRegistry,
 		const int32 ThreadCount)
 	{
 		TArray<FLoadChunkRunnable*> Runnables;
@@ -36,8 +67,9 @@ public:
 		for (int32 i = 0; i < ThreadCount; i++)
 		{
 			FLoadChunkRunnable* Runnable = new
-				FLoadChunkRunnable(InWorldGenerator, InLoadColumnQueue,
-				                   InCreateColumnQueue);
+				FLoadChunkRunnable(InWorldGenerator, InJobQueue, InJobDepths,
+				                   InCreateColumnQueue, InRegionStore, InMeshQueue,
+				                   InChunkRegistry);
 			Runnables.Add(Runnable);
 
 			FRunnableThread* Thread = FRunnableThread::Create(
@@ -50,25 +82,100 @@ public:
 	}
 
 	FLoadChunkRunnable(UWorldGenerator* InWorldGenerator,
-	                   const TSharedPtr<TThreadSafeQueue<FIntVector2>>& InLoadColumnQueue,
-	                   const TSharedPtr<TThreadSafeQueue<FChunkDataColumn>>&
-	                   InCreateColumnQueue):
-		WorldGenerator(InWorldGenerator),
-		LoadColumnQueue(InLoadColumnQueue),
-		CreateColumnQueue(InCreateColumnQueue)
+	                   const TSharedPtr<TMpmcQueue<FColumnJob>>& InJobQueue,
+	                   const TSharedPtr<FColumnJobDepths>& InJobDepths,
+	                   const TSharedPtr<TMpmcQueue<FChunkDataColumn>>&
+	                   InCreateColumnQueue,
+	                   const TSharedPtr<FRegionStore>& InRegionStore,
+	                   const TSharedPtr<TMpmcQueue<FChunkMesh>>& InMeshQueue,
+	                   UChunkRegistry* InChunkRegistry);
+
+	virtual ~FLoadChunkRunnable() override
 	{
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
 	}
 
 	virtual uint32 Run() override;
 
 	virtual void Stop() override;
 
+	const FLoadChunkWorkerStats& GetStats() const
+	{
+		return Stats;
+	}
+
 private:
+	/**
+	 * Full resolution columns come from the region store when saved there, otherwise
+	 * (and for LoD columns not in the store) they are generated at the requested resolution
+	 */
+	void LoadColumn(const FColumnJob& Job, FChunkDataColumn& OutColumn) const;
+
+	void GenerateColumn(const FColumnJob& Job) const;
+
+	/**
+	 * Mesh a registered column with the registered columns around it
+	 */
+	void MeshColumn(const FIntVector2& ColumnPos) const;
+
+	void SetState(const FIntVector2& ColumnPos, EColumnState State) const;
+
+	/**
+	 * Enqueue, waiting for room as long as the worker isn't stopped
+	 */
+	template <typename T>
+	void EnqueueOrWait(TMpmcQueue<T>& Queue, T&& Item) const
+	{
+		while (!Queue.Enqueue(MoveTemp(Item)) && StopTaskCounter.GetValue() == 0)
+		{
+			FPlatformProcess::Yield();
+		}
+	}
+
 	UWorldGenerator* WorldGenerator;
+
+	/**
+	 * This worker's own noise state, created on the game thread along with the runnable
+	 */
+	TUniquePtr<FTerrainNoise> Noise;
 	
-	TSharedPtr<TThreadSafeQueue<FIntVector2>> LoadColumnQueue;
+	/**
+	 * Generate jobs from the load scheduler and mesh jobs from the job graph, in one queue so
+	 * a parked worker wakes up for either
+	 */
+	TSharedPtr<TMpmcQueue<FColumnJob>> JobQueue;
 
-	TSharedPtr<TThreadSafeQueue<FChunkDataColumn>> CreateColumnQueue;
+	/**
+	 * Told about every job taken out of JobQueue, so the dispatchers know how many of their
+	 * kind still wait. Can be null when nothing budgets per kind
+	 */
+	TSharedPtr<FColumnJobDepths> JobDepths;
+
+	TSharedPtr<TMpmcQueue<FChunkDataColumn>> CreateColumnQueue;
+
+	/**
+	 * Columns are loaded from here when they were saved before, and saved once generated.
+	 * Can be null, then every column is generated
+	 */
+	TSharedPtr<FRegionStore> RegionStore;
+
+	/**
+	 * Non empty section meshes of the mesh jobs. Can be null, then mesh jobs are skipped
+	 */
+	TSharedPtr<TMpmcQueue<FChunkMesh>> MeshQueue;
+
+	/**
+	 * Told when a column starts generating, is generated and is meshed, and where mesh jobs
+	 * read the columns from. Can be null, then mesh jobs are skipped
+	 */
+	UChunkRegistry* ChunkRegistry;
 
 	FThreadSafeCounter StopTaskCounter;
+
+	FLoadChunkWorkerStats Stats;
+
+	/**
+	 * Parks the worker while JobQueue is empty, triggered by producers or Stop()
+	 */
+	FEvent* WakeEvent;
 };
@@ -0,0 +1,389 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Event.h"
+#include "Misc/ScopeLock.h"
+#include <atomic>
+
+/**
+ * Bounded lock-free multi-producer/multi-consumer FIFO queue.
+ *
+ * Ring buffer where every cell carries a sequence number (Vyukov's bounded MPMC queue):
+ * producers and consumers only contend on a single CAS of their own cursor, and never on
+ * a lock. Capacity is rounded up to a power of two, and Enqueue returns false instead of
+ * blocking when the ring is full. Elements only need to be move constructible.
+ *
+ * Consumers that run out of work can park in WaitForItems, producers wake them up on
+ * enqueue. Nobody parked means the producer only pays an atomic load.
+ */
+template <typename T>
+class TMpmcQueue
+{
+public:
+	static constexpr uint32 DefaultCapacity = 1024;
+
+	explicit TMpmcQueue(const uint32 InCapacity = DefaultCapacity)
+	{
+		const uint32 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(InCapacity, 2));
+		Mask = Capacity - 1;
+		Cells = static_cast<FCell*>(FMemory::Malloc(sizeof(FCell) * Capacity, alignof(FCell)));
+
+		for (uint32 Idx = 0; Idx < Capacity; Idx++)
+		{
+			new(&Cells[Idx]) FCell();
+			Cells[Idx].Sequence.store(Idx, std::memory_order_relaxed);
+		}
+
+		EnqueuePos.store(0, std::memory_order_relaxed);
+		DequeuePos.store(0, std::memory_order_relaxed);
+	}
+
+	~TMpmcQueue()
+	{
+		// Only safe once no other thread is touching the queue anymore
+		const uint64 Tail = EnqueuePos.load(std::memory_order_acquire);
+		for (uint64 Pos = DequeuePos.load(std::memory_order_acquire); Pos < Tail; Pos++)
+		{
+			DestructItem(Cells[Pos & Mask].Storage.GetTypedPtr());
+		}
+
+		for (uint32 Idx = 0; Idx <= Mask; Idx++)
+		{
+			Cells[Idx].~FCell();
+		}
+
+		FMemory::Free(Cells);
+	}
+
+	TMpmcQueue(const TMpmcQueue&) = delete;
+	TMpmcQueue& operator=(const TMpmcQueue&) = delete;
+
+	bool Enqueue(const T& Item)
+	{
+		return Emplace(Item);
+	}
+
+	bool Enqueue(T&& Item)
+	{
+		return Emplace(MoveTemp(Item));
+	}
+
+	/**
+	 * Construct the item in place at the tail, the arguments are left untouched when the
+	 * queue is full
+	 */
+	template <typename... ArgsType>
+	bool Emplace(ArgsType&&... Args)
+	{
+		uint64 Pos;
+		if (!ClaimEnqueue(1, Pos))
+		{
+			return false;
+		}
+
+		FCell& Cell = Cells[Pos & Mask];
+		new(Cell.Storage.GetTypedPtr()) T(Forward<ArgsType>(Args)...);
+		Cell.Sequence.store(Pos + 1, std::memory_order_release);
+
+		WakeWaiters(1);
+		return true;
+	}
+
+	/**
+	 * Move as many items as fit into the queue with a single claim of the tail.
+	 * Returns how many were moved, the remaining ones are left in place
+	 */
+	int32 EnqueueMany(TArrayView<T> Items)
+	{
+		int32 Enqueued = 0;
+		while (Enqueued < Items.Num())
+		{
+			uint64 StartPos;
+			const uint32 Count = ClaimEnqueueUpTo(Items.Num() - Enqueued, StartPos);
+			if (Count == 0)
+			{
+				break;
+			}
+
+			for (uint32 Offset = 0; Offset < Count; Offset++)
+			{
+				const uint64 Pos = StartPos + Offset;
+				FCell& Cell = Cells[Pos & Mask];
+				new(Cell.Storage.GetTypedPtr()) T(MoveTemp(Items[Enqueued + Offset]));
+				Cell.Sequence.store(Pos + 1, std::memory_order_release);
+			}
+
+			Enqueued += Count;
+		}
+
+		if (Enqueued)
+		{
+			WakeWaiters(Enqueued);
+		}
+
+		return Enqueued;
+	}
+
+	bool Dequeue(T& OutItem)
+	{
+		uint64 Pos;
+		if (!ClaimDequeue(1, Pos))
+		{
+			return false;
+		}
+
+		FCell& Cell = Cells[Pos & Mask];
+		T* Item = Cell.Storage.GetTypedPtr();
+		OutItem = MoveTemp(*Item);
+		DestructItem(Item);
+		Cell.Sequence.store(Pos + Mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	TOptional<T> Dequeue()
+	{
+		uint64 Pos;
+		if (!ClaimDequeue(1, Pos))
+		{
+			return {};
+		}
+
+		FCell& Cell = Cells[Pos & Mask];
+		T* Item = Cell.Storage.GetTypedPtr();
+		TOptional<T> Result{MoveTemp(*Item)};
+		DestructItem(Item);
+		Cell.Sequence.store(Pos + Mask + 1, std::memory_order_release);
+		return Result;
+	}
+
+	/**
+	 * Append up to Count items to OutRes, in FIFO order, with a single claim of the head.
+	 * Returns how many were dequeued
+	 */
+	int32 DequeueMany(TArray<T>& OutRes, const int32 Count)
+	{
+		int32 Dequeued = 0;
+		OutRes.Reserve(OutRes.Num() + Count);
+
+		while (Dequeued < Count)
+		{
+			uint64 Pos;
+			const uint32 Claimed = ClaimDequeueUpTo(Count - Dequeued, Pos);
+			if (Claimed == 0)
+			{
+				break;
+			}
+
+			for (uint32 Offset = 0; Offset < Claimed; Offset++)
+			{
+				FCell& Cell = Cells[(Pos + Offset) & Mask];
+				T* Item = Cell.Storage.GetTypedPtr();
+				OutRes.Add(MoveTemp(*Item));
+				DestructItem(Item);
+				Cell.Sequence.store(Pos + Offset + Mask + 1, std::memory_order_release);
+			}
+
+			Dequeued += Claimed;
+		}
+
+		return Dequeued;
+	}
+
+	/**
+	 * Approximate number of items, exact only when no other thread is touching the queue
+	 */
+	int32 Num() const
+	{
+		const uint64 Head = DequeuePos.load(std::memory_order_relaxed);
+		const uint64 Tail = EnqueuePos.load(std::memory_order_relaxed);
+		return Tail > Head ? static_cast<int32>(Tail - Head) : 0;
+	}
+
+	bool IsEmpty() const
+	{
+		return Num() == 0;
+	}
+
+	uint32 Capacity() const
+	{
+		return Mask + 1;
+	}
+
+	/**
+	 * Block the calling thread until an item might be available. Wakeups can be spurious,
+	 * so callers loop on Dequeue. WakeEvent must be an auto reset event owned by the caller,
+	 * triggering it from elsewhere (e.g. to stop a worker) also ends the wait
+	 */
+	void WaitForItems(FEvent* WakeEvent)
+	{
+		{
+			FScopeLock Lock(&WaitersLock);
+
+			// Announce ourselves before the last look at the queue, a producer either sees
+			// us waiting or we see its item
+			NumWaiters.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!IsEmpty())
+			{
+				NumWaiters.fetch_sub(1);
+				return;
+			}
+
+			Waiters.Add(WakeEvent);
+		}
+
+		WakeEvent->Wait();
+
+		// Woken by someone else than a producer, we are still registered
+		FScopeLock Lock(&WaitersLock);
+		if (Waiters.RemoveSingleSwap(WakeEvent))
+		{
+			NumWaiters.fetch_sub(1);
+		}
+	}
+
+	/**
+	 * Wake up to Count consumers parked in WaitForItems
+	 */
+	void WakeWaiters(int32 Count)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (NumWaiters.load(std::memory_order_relaxed) == 0)
+		{
+			return;
+		}
+
+		FScopeLock Lock(&WaitersLock);
+		while (Count-- > 0 && Waiters.Num())
+		{
+			Waiters.Pop()->Trigger();
+			NumWaiters.fetch_sub(1);
+		}
+	}
+
+	void WakeAllWaiters()
+	{
+		WakeWaiters(MAX_int32);
+	}
+
+private:
+	struct FCell
+	{
+		std::atomic<uint64> Sequence;
+
+		TTypeCompatibleBytes<T> Storage;
+	};
+
+	bool ClaimEnqueue(const uint32 Count, uint64& OutPos)
+	{
+		return ClaimEnqueueUpTo(Count, OutPos) == Count;
+	}
+
+	bool ClaimDequeue(const uint32 Count, uint64& OutPos)
+	{
+		return ClaimDequeueUpTo(Count, OutPos) == Count;
+	}
+
+	/**
+	 * Reserve up to MaxCount consecutive free cells at the tail. A cell is free when its
+	 * sequence equals its position, and it can't stop being free until we publish into it
+	 */
+	uint32 ClaimEnqueueUpTo(const uint32 MaxCount, uint64& OutPos)
+	{
+		uint64 Pos = EnqueuePos.load(std::memory_order_relaxed);
+		while (true)
+		{
+			uint32 Count = 0;
+			bool bStale = false;
+			while (Count < MaxCount && Count <= Mask)
+			{
+				const uint64 Seq = Cells[(Pos + Count) & Mask].Sequence.load(
+					std::memory_order_acquire);
+				if (Seq != Pos + Count)
+				{
+					// Another producer already moved past this position
+					bStale = Count == 0 && Seq > Pos;
+					break;
+				}
+
+				Count++;
+			}
+
+			if (Count == 0)
+			{
+				if (!bStale)
+				{
+					return 0;
+				}
+
+				Pos = EnqueuePos.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (EnqueuePos.compare_exchange_weak(Pos, Pos + Count, std::memory_order_relaxed))
+			{
+				OutPos = Pos;
+				return Count;
+			}
+		}
+	}
+
+	/**
+	 * Reserve up to MaxCount consecutive published cells at the head. A cell is published
+	 * when its sequence is one past its position
+	 */
+	uint32 ClaimDequeueUpTo(const uint32 MaxCount, uint64& OutPos)
+	{
+		uint64 Pos = DequeuePos.load(std::memory_order_relaxed);
+		while (true)
+		{
+			uint32 Count = 0;
+			bool bStale = false;
+			while (Count < MaxCount && Count <= Mask)
+			{
+				const uint64 Seq = Cells[(Pos + Count) & Mask].Sequence.load(
+					std::memory_order_acquire);
+				if (Seq != Pos + Count + 1)
+				{
+					// Another consumer already moved past this position
+					bStale = Count == 0 && Seq > Pos + 1;
+					break;
+				}
+
+				Count++;
+			}
+
+			if (Count == 0)
+			{
+				if (!bStale)
+				{
+					return 0;
+				}
+
+				Pos = DequeuePos.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (DequeuePos.compare_exchange_weak(Pos, Pos + Count, std::memory_order_relaxed))
+			{
+				OutPos = Pos;
+				return Count;
+			}
+		}
+	}
+
+	FCell* Cells = nullptr;
+
+	uint32 Mask = 0;
+
+	// Producers and consumers live on separate cache lines so they don't false share
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> EnqueuePos;
+
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> DequeuePos;
+
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<int32> NumWaiters{0};
+
+	FCriticalSection WaitersLock;
+
+	TArray<FEvent*> Waiters;
+};
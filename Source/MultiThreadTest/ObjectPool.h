@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "MpmcQueue.h"
+
+/**
+ * Thread safe free list of heap allocated objects, so hot paths reuse their allocations
+ * instead of going back to the allocator. Objects released while the free list is full
+ * are deleted.
+ */
+template <typename T>
+class TObjectPool
+{
+public:
+	explicit TObjectPool(const uint32 Capacity = 256) : FreeList(Capacity)
+	{
+	}
+
+	~TObjectPool()
+	{
+		T* Object;
+		while (FreeList.Dequeue(Object))
+		{
+			delete Object;
+		}
+	}
+
+	T* Acquire()
+	{
+		T* Object;
+		if (FreeList.Dequeue(Object))
+		{
+			return Object;
+		}
+
+		return new T();
+	}
+
+	void Release(T* Object)
+	{
+		if (!FreeList.Enqueue(Object))
+		{
+			delete Object;
+		}
+	}
+
+private:
+	TMpmcQueue<T*> FreeList;
+};
+
+/**
+ * Owns an object acquired from a TObjectPool and gives it back when going out of scope
+ */
+template <typename T>
+class TPooledObject
+{
+public:
+	/**
+	 * Empty, e.g. to dequeue into
+	 */
+	TPooledObject() : Pool(nullptr), Object(nullptr)
+	{
+	}
+
+	explicit TPooledObject(TObjectPool<T>& InPool) : Pool(&InPool), Object(InPool.Acquire())
+	{
+	}
+
+	TPooledObject(TPooledObject&& Other) : Pool(Other.Pool), Object(Other.Object)
+	{
+		Other.Object = nullptr;
+	}
+
+	TPooledObject& operator=(TPooledObject&& Other)
+	{
+		if (this != &Other)
+		{
+			Reset();
+			Pool = Other.Pool;
+			Object = Other.Object;
+			Other.Object = nullptr;
+		}
+
+		return *this;
+	}
+
+	TPooledObject(const TPooledObject&) = delete;
+	TPooledObject& operator=(const TPooledObject&) = delete;
+
+	~TPooledObject()
+	{
+		Reset();
+	}
+
+	/**
+	 * Give the object back to its pool now
+	 */
+	void Reset()
+	{
+		if (Object)
+		{
+			Pool->Release(Object);
+			Object = nullptr;
+		}
+	}
+
+	bool IsValid() const
+	{
+		return Object != nullptr;
+	}
+
+	T* Get() const
+	{
+		return Object;
+	}
+
+	T* operator->() const
+	{
+		return Object;
+	}
+
+	T& operator*() const
+	{
+		return *Object;
+	}
+
+private:
+	TObjectPool<T>* Pool;
+
+	T* Object;
+};
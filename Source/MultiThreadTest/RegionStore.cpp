@@ -0,0 +1,342 @@
+﻿#include "RegionStore.h"
+
+#include "ChunkColumnCodec.h"
+#include "ChunkDataColumn.h"
+#include "ChunksStat.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+FRegionStore::FRegionStore(const FString& InDirectory, const uint32 InSettingsHash,
+                           const int64 InMaxSavedBytes) :
+	Directory(InDirectory), SettingsHash(InSettingsHash), MaxSavedBytes(InMaxSavedBytes)
+{
+	IFileManager::Get().MakeDirectory(*Directory, true);
+}
+
+FRegionStore::~FRegionStore() = default;
+
+bool FRegionStore::Load(const FIntVector2& ColumnPos, FChunkDataColumn& OutColumn)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RegionLoad);
+
+	const FRegionPtr RegionPtr = FindOrAddRegion(ToRegionPos(ColumnPos));
+	FRegion& Region = *RegionPtr;
+	const int32 LocalIndex = ToLocalIndex(ColumnPos);
+
+	while (true)
+	{
+		if (!Region.bMapTried.load(std::memory_order_acquire))
+		{
+			FRWScopeLock Lock(Region.Lock, SLT_Write);
+			MapRegion(Region);
+		}
+
+		FRWScopeLock Lock(Region.Lock, SLT_ReadOnly);
+
+		// A flush unmapped the file in between
+		if (!Region.bMapTried.load(std::memory_order_relaxed))
+		{
+			continue;
+		}
+
+		const TConstArrayView<uint8> Payload = FindPayload(Region, LocalIndex);
+		if (Payload.IsEmpty())
+		{
+			return false;
+		}
+
+		if (!FChunkColumnCodec::Decode(Payload, OutColumn) || OutColumn.ColumnPos != ColumnPos)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Corrupted column %d,%d in %s"),
+			       ColumnPos.X, ColumnPos.Y, *Region.Path);
+			return false;
+		}
+
+		return true;
+	}
+}
+
+void FRegionStore::Save(const FChunkDataColumn& Column)
+{
+	SCOPE_CYCLE_COUNTER(STAT_RegionSave);
+
+	TArray<uint8> Payload;
+	FChunkColumnCodec::Encode(Column, Payload, EColumnCompression::LZ4);
+
+	const int32 LocalIndex = ToLocalIndex(Column.ColumnPos);
+	while (true)
+	{
+		const FRegionPtr Region = FindOrAddRegion(ToRegionPos(Column.ColumnPos));
+		FRWScopeLock Lock(Region->Lock, SLT_Write);
+
+		// Written and dropped since we found it, the map has a new one
+		if (Region->bEvicted)
+		{
+			continue;
+		}
+
+		int64 Added = Payload.Num();
+		if (const TArray<uint8>* Previous = Region->Saved.Find(LocalIndex))
+		{
+			Added -= Previous->Num();
+		}
+
+		Region->Saved.Add(LocalIndex, MoveTemp(Payload));
+		Region->SavedBytes.fetch_add(Added, std::memory_order_relaxed);
+		SavedBytes.fetch_add(Added, std::memory_order_relaxed);
+		break;
+	}
+
+	if (SavedBytes.load(std::memory_order_relaxed) > MaxSavedBytes)
+	{
+		FlushLargestRegion();
+	}
+}
+
+int32 FRegionStore::Flush()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RegionFlush);
+
+	TArray<FRegionPtr> ToWrite;
+	{
+		FRWScopeLock Lock(RegionsLock, SLT_ReadOnly);
+		Regions.GenerateValueArray(ToWrite);
+	}
+
+	int32 Written = 0;
+	for (const FRegionPtr& Region : ToWrite)
+	{
+		if (FlushRegion(Region))
+		{
+			Written++;
+		}
+	}
+
+	return Written;
+}
+
+bool FRegionStore::FlushRegion(const FRegionPtr& Region)
+{
+	{
+		FRWScopeLock Lock(Region->Lock, SLT_Write);
+		if (Region->Saved.IsEmpty() || !WriteRegion(*Region))
+		{
+			return false;
+		}
+	}
+
+	EvictRegion(Region);
+	return true;
+}
+
+void FRegionStore::EvictRegion(const FRegionPtr& Region)
+{
+	FRWScopeLock RegionsWriteLock(RegionsLock, SLT_Write);
+	FRWScopeLock Lock(Region->Lock, SLT_Write);
+
+	// Saved to again after it was written, it stays until the next flush
+	if (Region->bEvicted || Region->Saved.Num())
+	{
+		return;
+	}
+
+	UnmapRegion(*Region);
+	Region->bEvicted = true;
+	Regions.Remove(Region->Pos);
+}
+
+void FRegionStore::FlushLargestRegion()
+{
+	// The other savers carry on with their jobs meanwhile
+	if (bFlushing.exchange(true, std::memory_order_acquire))
+	{
+		return;
+	}
+
+	FRegionPtr Largest;
+	int64 LargestBytes = 0;
+	{
+		FRWScopeLock Lock(RegionsLock, SLT_ReadOnly);
+		for (const auto& [RegionPos, Region] : Regions)
+		{
+			const int64 RegionBytes = Region->SavedBytes.load(std::memory_order_relaxed);
+			if (RegionBytes > LargestBytes)
+			{
+				Largest = Region;
+				LargestBytes = RegionBytes;
+			}
+		}
+	}
+
+	if (Largest)
+	{
+		FlushRegion(Largest);
+	}
+
+	bFlushing.store(false, std::memory_order_release);
+}
+
+FIntVector2 FRegionStore::ToRegionPos(const FIntVector2& ColumnPos)
+{
+	// Round toward negative infinity, so column -1 lands in region -1 and not 0
+	const auto FloorDivide = [](const int32 Value)
+	{
+		constexpr int32 GroupSize = FGameConstants::ChunkGroupSize;
+		return Value >= 0 ? Value / GroupSize : (Value + 1) / GroupSize - 1;
+	};
+
+	return FIntVector2(FloorDivide(ColumnPos.X), FloorDivide(ColumnPos.Y));
+}
+
+int32 FRegionStore::ToLocalIndex(const FIntVector2& ColumnPos)
+{
+	constexpr int32 GroupSize = FGameConstants::ChunkGroupSize;
+	const FIntVector2 RegionPos = ToRegionPos(ColumnPos);
+	const int32 LocalX = ColumnPos.X - RegionPos.X * GroupSize;
+	const int32 LocalY = ColumnPos.Y - RegionPos.Y * GroupSize;
+	return LocalX * GroupSize + LocalY;
+}
+
+FRegionStore::FRegionPtr FRegionStore::FindOrAddRegion(const FIntVector2& RegionPos)
+{
+	{
+		FRWScopeLock Lock(RegionsLock, SLT_ReadOnly);
+		if (const FRegionPtr* Region = Regions.Find(RegionPos))
+		{
+			return *Region;
+		}
+	}
+
+	FRWScopeLock Lock(RegionsLock, SLT_Write);
+	FRegionPtr& Region = Regions.FindOrAdd(RegionPos);
+	if (!Region)
+	{
+		Region = MakeShared<FRegion, ESPMode::ThreadSafe>();
+		Region->Pos = RegionPos;
+		Region->Path = FPaths::Combine(
+			Directory, FString::Printf(TEXT("r.%d.%d.region"), RegionPos.X, RegionPos.Y));
+	}
+
+	return Region;
+}
+
+void FRegionStore::MapRegion(FRegion& Region) const
+{
+	if (Region.bMapTried.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	if (FPaths::FileExists(Region.Path))
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		Region.MappedHandle.Reset(PlatformFile.OpenMapped(*Region.Path));
+		if (Region.MappedHandle)
+		{
+			Region.MappedRegion.Reset(Region.MappedHandle->MapRegion());
+		}
+	}
+
+	Region.bMapTried.store(true, std::memory_order_release);
+}
+
+void FRegionStore::UnmapRegion(FRegion& Region)
+{
+	// The region has to go before the handle it was mapped from
+	Region.MappedRegion.Reset();
+	Region.MappedHandle.Reset();
+	Region.bMapTried.store(false, std::memory_order_release);
+}
+
+TConstArrayView<uint8> FRegionStore::FindMappedPayload(const FRegion& Region,
+                                                       const int32 LocalIndex) const
+{
+	if (!Region.MappedRegion)
+	{
+		return {};
+	}
+
+	const uint8* Data = Region.MappedRegion->GetMappedPtr();
+	const int64 Size = Region.MappedRegion->GetMappedSize();
+	const int64 TableEnd = sizeof(FHeader) + sizeof(FEntry) * ColumnsPerRegion;
+	if (Size < TableEnd)
+	{
+		return {};
+	}
+
+	FHeader Header;
+	FMemory::Memcpy(&Header, Data, sizeof(FHeader));
+	if (Header.Magic != Magic || Header.Version != Version ||
+		Header.SettingsHash != SettingsHash || Header.ColumnCount != ColumnsPerRegion)
+	{
+		return {};
+	}
+
+	FEntry Entry;
+	FMemory::Memcpy(&Entry, Data + sizeof(FHeader) + sizeof(FEntry) * LocalIndex, sizeof(FEntry));
+	if (Entry.Offset < TableEnd || Entry.Offset + static_cast<int64>(Entry.Size) > Size)
+	{
+		return {};
+	}
+
+	return TConstArrayView<uint8>(Data + Entry.Offset, Entry.Size);
+}
+
+TConstArrayView<uint8> FRegionStore::FindPayload(const FRegion& Region,
+                                                 const int32 LocalIndex) const
+{
+	// Saved columns are newer than whatever the file holds
+	if (const TArray<uint8>* Saved = Region.Saved.Find(LocalIndex))
+	{
+		return *Saved;
+	}
+
+	return FindMappedPayload(Region, LocalIndex);
+}
+
+bool FRegionStore::WriteRegion(FRegion& Region)
+{
+	// Columns already on disk are carried over, so the file has to be mapped
+	MapRegion(Region);
+
+	constexpr int32 TableEnd = sizeof(FHeader) + sizeof(FEntry) * ColumnsPerRegion;
+
+	TArray<uint8> File;
+	File.SetNumZeroed(TableEnd);
+
+	const FHeader Header{Magic, Version, SettingsHash, ColumnsPerRegion};
+	FMemory::Memcpy(File.GetData(), &Header, sizeof(FHeader));
+
+	for (int32 LocalIndex = 0; LocalIndex < ColumnsPerRegion; LocalIndex++)
+	{
+		const TConstArrayView<uint8> Payload = FindPayload(Region, LocalIndex);
+		if (Payload.IsEmpty())
+		{
+			continue;
+		}
+
+		const FEntry Entry{static_cast<uint32>(File.Num()), static_cast<uint32>(Payload.Num())};
+		FMemory::Memcpy(File.GetData() + sizeof(FHeader) + sizeof(FEntry) * LocalIndex, &Entry,
+		                sizeof(FEntry));
+		File.Append(Payload.GetData(), Payload.Num());
+	}
+
+	// Mapped files can't be replaced, and everything we needed from it was copied
+	UnmapRegion(Region);
+
+	const FString TempPath = Region.Path + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(File, *TempPath) ||
+		!IFileManager::Get().Move(*Region.Path, *TempPath, true))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to write region %s"), *Region.Path);
+		return false;
+	}
+
+	Region.Saved.Empty();
+	SavedBytes.fetch_sub(Region.SavedBytes.exchange(0, std::memory_order_relaxed),
+	                     std::memory_order_relaxed);
+	return true;
+}
@@ -0,0 +1,192 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Constants/GameConstants.h"
+#include <atomic>
+
+struct FChunkDataColumn;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * On disk cache of generated columns, so a column only gets generated once per world.
+ *
+ * Columns are grouped in regions of ChunkGroupSize x ChunkGroupSize, one file per region:
+ * a header, an offset table with one entry per column, then the encoded columns
+ * (FChunkColumnCodec, LZ4 compressed). Region files are memory mapped on first use, so loading
+ * a column is a page fault plus a decode.
+ *
+ * Load and Save can be called from any thread. Saved columns are kept compressed in memory
+ * until their region file is rewritten: by Flush, or by Save once more than MaxSavedBytes
+ * are waiting. A written region is dropped from memory, and mapped again if one of its
+ * columns is loaded later. Files written for other generator settings (see
+ * UWorldGenerator::GetSettingsHash) are ignored and overwritten on the next flush.
+ */
+class FRegionStore
+{
+public:
+	FRegionStore(const FString& InDirectory, uint32 InSettingsHash,
+	             int64 InMaxSavedBytes = DefaultMaxSavedBytes);
+
+	~FRegionStore();
+
+	FRegionStore(const FRegionStore&) = delete;
+	FRegionStore& operator=(const FRegionStore&) = delete;
+
+	/**
+	 * Returns false if the column was never saved
+	 */
+	bool Load(const FIntVector2& ColumnPos, FChunkDataColumn& OutColumn);
+
+	/**
+	 * Past MaxSavedBytes waiting to be written, the calling thread writes the region holding
+	 * the most of them
+	 */
+	void Save(const FChunkDataColumn& Column);
+
+	/**
+	 * Write every region with saved columns back to disk. Returns how many files were written
+	 */
+	int32 Flush();
+
+	/**
+	 * Encoded columns saved and not written yet
+	 */
+	int64 GetSavedBytes() const
+	{
+		return SavedBytes.load(std::memory_order_relaxed);
+	}
+
+	static constexpr int64 DefaultMaxSavedBytes = 32 * 1024 * 1024;
+
+	static constexpr int32 ColumnsPerRegion = FGameConstants::ChunkGroupSize *
+		FGameConstants::ChunkGroupSize;
+
+private:
+	struct FHeader
+	{
+		uint32 Magic;
+
+		uint32 Version;
+
+		uint32 SettingsHash;
+
+		uint32 ColumnCount;
+	};
+
+	/**
+	 * Offset 0 means the column isn't in the file
+	 */
+	struct FEntry
+	{
+		uint32 Offset;
+
+		uint32 Size;
+	};
+
+	struct FRegion
+	{
+		FIntVector2 Pos;
+
+		FString Path;
+
+		/**
+		 * Readers hold it shared while they touch the mapping or the saved columns, mapping,
+		 * saving and flushing hold it exclusive
+		 */
+		FRWLock Lock;
+
+		TUniquePtr<IMappedFileHandle> MappedHandle;
+
+		TUniquePtr<IMappedFileRegion> MappedRegion;
+
+		/**
+		 * Set once we tried to map the file, whether it exists or not
+		 */
+		std::atomic<bool> bMapTried{false};
+
+		/**
+		 * Columns saved since the last flush, by local column index
+		 */
+		TMap<int32, TArray<uint8>> Saved;
+
+		/**
+		 * Size of Saved, written under Lock and read without it to pick what to flush
+		 */
+		std::atomic<int64> SavedBytes{0};
+
+		/**
+		 * Written and removed from Regions, set under Lock. Savers holding it go through
+		 * Regions again
+		 */
+		bool bEvicted = false;
+	};
+
+	using FRegionPtr = TSharedPtr<FRegion, ESPMode::ThreadSafe>;
+
+	static constexpr uint32 Magic = 0x4E474552; // "REGN"
+	static constexpr uint32 Version = 2;
+
+	static FIntVector2 ToRegionPos(const FIntVector2& ColumnPos);
+
+	static int32 ToLocalIndex(const FIntVector2& ColumnPos);
+
+	FRegionPtr FindOrAddRegion(const FIntVector2& RegionPos);
+
+	/**
+	 * Map the region file if nobody tried yet, Region.Lock must be held exclusive
+	 */
+	void MapRegion(FRegion& Region) const;
+
+	static void UnmapRegion(FRegion& Region);
+
+	/**
+	 * Encoded column stored in the mapped file, Region.Lock must be held
+	 */
+	TConstArrayView<uint8> FindMappedPayload(const FRegion& Region, int32 LocalIndex) const;
+
+	/**
+	 * Encoded column, saved or mapped, Region.Lock must be held
+	 */
+	TConstArrayView<uint8> FindPayload(const FRegion& Region, int32 LocalIndex) const;
+
+	/**
+	 * Region.Lock must be held exclusive
+	 */
+	bool WriteRegion(FRegion& Region);
+
+	/**
+	 * Write the region if it has saved columns, then drop it. Returns whether it was written
+	 */
+	bool FlushRegion(const FRegionPtr& Region);
+
+	/**
+	 * Remove a written region from Regions, unless columns were saved to it meanwhile
+	 */
+	void EvictRegion(const FRegionPtr& Region);
+
+	/**
+	 * Flush the region with the most saved bytes, skipped if another thread already does
+	 */
+	void FlushLargestRegion();
+
+	FString Directory;
+
+	uint32 SettingsHash;
+
+	int64 MaxSavedBytes;
+
+	/**
+	 * Sum of every region's SavedBytes
+	 */
+	std::atomic<int64> SavedBytes{0};
+
+	std::atomic<bool> bFlushing{false};
+
+	FRWLock RegionsLock;
+
+	/**
+	 * Shared so Load and Save can keep using a region evicted under them
+	 */
+	TMap<FIntVector2, FRegionPtr> Regions;
+};
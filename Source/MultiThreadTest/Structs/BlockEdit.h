@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * One block to write in a section, see FHierarchicalGrid::ApplyEdits
+ */
+struct FBlockEdit
+{
+	uint8 X = 0;
+
+	uint8 Y = 0;
+
+	uint8 Z = 0;
+
+	uint32 BlockId = 0;
+
+	/**
+	 * Layer, then row, then col order: the order ApplyEdits walks the hierarchy in
+	 */
+	uint32 GetSortKey() const
+	{
+		return Z << 16 | X << 8 | Y;
+	}
+};
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "MultiThreadTest/ObjectPool.h"
+#include "MultiThreadTest/Constants/GameConstants.h"
+
+/**
+ * Dense Resolution³ block ids, for code that wants random access writes (generators, cave
+ * carvers, editors). Write into it freely, then encode it into a FHierarchicalGrid with
+ * FHierarchicalDenseCodec.
+ *
+ * Blocks are laid out so that the runs of a grid col (Y) are contiguous, then rows (X),
+ * then layers (Z).
+ */
+struct FDenseBlockBuffer
+{
+	uint8 Resolution = FGameConstants::ChunkSize;
+
+	TArray<uint32> Blocks;
+
+	/**
+	 * Pooled buffer of the given resolution, reset to InBlockId
+	 */
+	static TPooledObject<FDenseBlockBuffer> Acquire(const uint8 InResolution,
+	                                                const uint32 InBlockId = 0)
+	{
+		TPooledObject<FDenseBlockBuffer> Buffer{GetPool(InResolution)};
+		Buffer->Reset(InResolution, InBlockId);
+		return Buffer;
+	}
+
+	void Reset(const uint8 InResolution, const uint32 InBlockId = 0)
+	{
+		Resolution = InResolution;
+		Blocks.SetNumUninitialized(InResolution * InResolution * InResolution);
+		Fill(Blocks.GetData(), Blocks.Num(), InBlockId);
+	}
+
+	int32 Index(const uint8 X, const uint8 Y, const uint8 Z) const
+	{
+		return (Z * Resolution + X) * Resolution + Y;
+	}
+
+	uint32 Get(const uint8 X, const uint8 Y, const uint8 Z) const
+	{
+		return Blocks[Index(X, Y, Z)];
+	}
+
+	void Set(const uint8 X, const uint8 Y, const uint8 Z, const uint32 InBlockId)
+	{
+		Blocks[Index(X, Y, Z)] = InBlockId;
+	}
+
+	/**
+	 * Plain contiguous stores, so the compiler turns it into vector stores
+	 */
+	static void Fill(uint32* RESTRICT Dest, const int32 Count, const uint32 InBlockId)
+	{
+		for (int32 Idx = 0; Idx < Count; Idx++)
+		{
+			Dest[Idx] = InBlockId;
+		}
+	}
+
+private:
+	static TObjectPool<FDenseBlockBuffer>& GetPool(const uint8 InResolution)
+	{
+		checkf(FMath::IsPowerOfTwo(InResolution) && InResolution <= FGameConstants::ChunkSize,
+		       TEXT("Invalid resolution %d"), InResolution);
+
+		// One pool per resolution, so a recycled buffer already has the right size
+		static TObjectPool<FDenseBlockBuffer> Pools[FloorLog2Constexpr(FGameConstants::ChunkSize) + 1];
+		return Pools[FMath::FloorLog2(InResolution)];
+	}
+
+	static constexpr uint32 FloorLog2Constexpr(const uint32 Value)
+	{
+		return Value <= 1 ? 0 : 1 + FloorLog2Constexpr(Value / 2);
+	}
+};
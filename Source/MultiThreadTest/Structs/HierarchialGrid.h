@@ -1,8 +1,11 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
+#include "Algo/StableSort.h"
+#include "BlockEdit.h"
 #include "FindResult.h"
 #include "HierarchialLayer.h"
+#include "SpanArray.h"
 #include "HierarchialGrid.generated.h"
 
 struct FLayersSplit;
@@ -11,6 +14,24 @@ struct FGameConstants;
 
 // TODO change orientation of rows to another axis if it's is more efficient?
 
+/**
+ * What a section holds at a glance, without walking it. Uniform sections own no memory
+ */
+enum class ESectionTag : uint8
+{
+	/**
+	 * Only block 0, nothing to mesh
+	 */
+	Air,
+
+	/**
+	 * A single non air block, only has faces where it borders something else
+	 */
+	Solid,
+
+	Mixed,
+};
+
 USTRUCT(BlueprintType)
 struct FHierarchicalGrid
 {
@@ -43,11 +64,87 @@ struct FHierarchicalGrid
 	UPROPERTY()
 	TArray<FHierarchicalLayer> Layers;
 
+	/**
+	 * Bit N is set when a layer starts at Z = N, see FHierarchicalRow::SpanStarts
+	 */
+	uint16 SpanStarts = 0;
+
+	void RebuildSpanStarts()
+	{
+		SpanStarts = FSpanArray::BuildStarts(Layers);
+	}
+
 	bool IsUniform() const
 	{
 		return Layers.Num() == 0 && BlockId != -1;
 	}
 
+	ESectionTag GetTag() const
+	{
+		if (!IsUniform())
+		{
+			return ESectionTag::Mixed;
+		}
+
+		return BlockId ? ESectionTag::Solid : ESectionTag::Air;
+	}
+
+	bool Serialize(FArchive& Ar)
+	{
+		Ar << BlockId << Resolution << Layers;
+		if (Ar.IsLoading())
+		{
+			RebuildSpanStarts();
+		}
+
+		return true;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FHierarchicalGrid& Grid)
+	{
+		Grid.Serialize(Ar);
+		return Ar;
+	}
+
+	/**
+	 * Heap memory owned by the grid. Rows and cols mostly live inline, so a non uniform
+	 * grid is usually a single allocation (its layers), and a uniform one none at all
+	 */
+	SIZE_T GetAllocatedSize() const
+	{
+		SIZE_T Size = Layers.GetAllocatedSize();
+		for (const auto& Layer : Layers)
+		{
+			Size += Layer.GetAllocatedSize();
+		}
+
+		return Size;
+	}
+
+	/**
+	 * Number of uniform runs the grid is made of, whatever level they live at: 1 for a
+	 * uniform grid, up to Resolution² cols per layer for a noisy one
+	 */
+	int32 NumSpans() const
+	{
+		if (IsUniform())
+		{
+			return 1;
+		}
+
+		int32 Spans = 0;
+		for (const auto& Layer : Layers)
+		{
+			Spans += Layer.NumSpans();
+		}
+
+		return Spans;
+	}
+
+	/**
+	 * Set a single block. Only splits spans, never merges them back: repeated edits of an
+	 * area fragment the grid, batch them with ApplyEdits instead
+	 */
 	void Set(const uint8 X, const uint8 Y, const uint8 Z, const uint32 InBlockId)
 	{
 		const auto CurrentBlockId = Get(X, Y, Z);
@@ -80,6 +177,7 @@ struct FHierarchicalGrid
 			Layers.Insert(SplitLayers.All(), Result.StartIdx);
 			
 			BlockId = -1;
+			RebuildSpanStarts();
 			
 			const auto Offset = SplitLayers.Before.IsSet() ? 1 : 0;
 			Layer = &Layers[Result.StartIdx + Offset];
@@ -88,25 +186,190 @@ struct FHierarchicalGrid
 		Layer->Set(InBlockId, X, Y);
 	}
 
-	uint32 Get(const uint8 X, const uint8 Y, const uint8 Z) const
+	/**
+	 * Write many blocks in one pass, then merge back adjacent identical cols, rows and layers
+	 * so an edited area recompresses. Edits are sorted in place (layer, row, col), edits of
+	 * the same block are applied in order and the last one wins.
+	 *
+	 * Returns how many blocks changed, the grid isn't touched when none did
+	 */
+	int32 ApplyEdits(const TArrayView<FBlockEdit> Edits)
 	{
+		Algo::StableSortBy(Edits, [](const FBlockEdit& Edit)
+		{
+			return Edit.GetSortKey();
+		});
+
+		// Keep the last edit of every block, and only the ones changing something. The grid
+		// is still intact here, so reads are valid
+		int32 NumChanged = 0;
+		for (int32 Idx = 0; Idx < Edits.Num(); Idx++)
+		{
+			const FBlockEdit& Edit = Edits[Idx];
+			checkf(Edit.X < Resolution && Edit.Y < Resolution && Edit.Z < Resolution,
+			       TEXT("Edit %d,%d,%d out of bounds"), Edit.X, Edit.Y, Edit.Z);
+
+			const bool bOverwritten = Idx + 1 < Edits.Num() &&
+				Edits[Idx + 1].GetSortKey() == Edit.GetSortKey();
+			if (!bOverwritten && Get(Edit.X, Edit.Y, Edit.Z) != Edit.BlockId)
+			{
+				Edits[NumChanged++] = Edit;
+			}
+		}
+
+		if (!NumChanged)
+		{
+			return 0;
+		}
+
 		if (IsUniform())
 		{
-			return BlockId;
+			Layers.Add(FHierarchicalLayer{Resolution, BlockId, Resolution});
+			BlockId = -1;
+		}
+
+		int32 First = 0;
+		while (First < NumChanged)
+		{
+			const uint8 Z = Edits[First].Z;
+			int32 End = First + 1;
+			while (End < NumChanged && Edits[End].Z == Z)
+			{
+				End++;
+			}
+
+			const int32 LayerIdx = FSpanArray::SplitAt(Layers, Z);
+			FSpanArray::SplitAt(Layers, Z + 1);
+			Layers[LayerIdx].ApplyEdits(Edits.Slice(First, End - First));
+			First = End;
+		}
+
+		FSpanArray::Merge(Layers);
+		if (Layers.Num() == 1 && Layers[0].IsUniform())
+		{
+			BlockId = Layers[0].BlockId;
+			Layers.Empty();
+		}
+
+		RebuildSpanStarts();
+		return NumChanged;
+	}
+
+	/**
+	 * Set every block of the box (inclusive bounds) straight in the span encoding, layers
+	 * and rows are only split at the box edges and merged back afterward
+	 */
+	void FillBox(const FIntVector& Min, const FIntVector& Max, const uint32 InBlockId)
+	{
+		checkf(Min.Z <= Max.Z && Max.Z < Resolution, TEXT("Invalid layers %d-%d"), Min.Z, Max.Z);
+
+		if (Min == FIntVector::ZeroValue && Max == FIntVector(Resolution - 1))
+		{
+			Layers.Empty();
+			BlockId = InBlockId;
+			return;
+		}
+
+		if (IsUniform())
+		{
+			if (BlockId == InBlockId)
+			{
+				return;
+			}
+
+			Layers.Add(FHierarchicalLayer{Resolution, BlockId, Resolution});
+			BlockId = -1;
+		}
+
+		const int32 First = FSpanArray::SplitAt(Layers, Min.Z);
+		const int32 End = FSpanArray::SplitAt(Layers, Max.Z + 1);
+		for (int32 LayerIdx = First; LayerIdx < End; LayerIdx++)
+		{
+			Layers[LayerIdx].FillRect(Min.X, Min.Y, Max.X, Max.Y, InBlockId);
+		}
+
+		FSpanArray::Coalesce(Layers, First, End - 1);
+
+		if (Layers.Num() == 1 && Layers[0].IsUniform())
+		{
+			BlockId = Layers[0].BlockId;
+			Layers.Empty();
+		}
+
+		RebuildSpanStarts();
+	}
+
+	/**
+	 * Set the blocks from MinZ to MaxZ (inclusive) at a single XY
+	 */
+	void FillColumnSpan(const uint8 X, const uint8 Y, const uint8 MinZ, const uint8 MaxZ,
+	                    const uint32 InBlockId)
+	{
+		FillBox(FIntVector(X, Y, MinZ), FIntVector(X, Y, MaxZ), InBlockId);
+	}
+
+	/**
+	 * Call Function(Min, Max, BlockId) for every uniform box of the span encoding (inclusive
+	 * bounds, X/Y/Z in block units of this resolution). The boxes tile the grid exactly,
+	 * and there are as many as leaves in the hierarchy, not as many as blocks
+	 */
+	template <typename FunctionType>
+	void ForEachUniformBox(FunctionType&& Function) const
+	{
+		const int32 Last = Resolution - 1;
+		if (IsUniform())
+		{
+			Function(FIntVector(0, 0, 0), FIntVector(Last), BlockId);
+			return;
 		}
 
-		int Index = 0;
+		int32 Z = 0;
 		for (const auto& Layer : Layers)
 		{
-			if (Index + Layer.Span > Z)
+			const int32 MaxZ = Z + Layer.Span - 1;
+			if (Layer.IsUniform())
 			{
-				return Layer.GetXY(X, Y);
+				Function(FIntVector(0, 0, Z), FIntVector(Last, Last, MaxZ), Layer.BlockId);
+				Z += Layer.Span;
+				continue;
+			}
+
+			int32 X = 0;
+			for (const auto& Row : Layer.Rows)
+			{
+				const int32 MaxX = X + Row.Span - 1;
+				if (Row.IsUniform())
+				{
+					Function(FIntVector(X, 0, Z), FIntVector(MaxX, Last, MaxZ), Row.BlockId);
+					X += Row.Span;
+					continue;
+				}
+
+				int32 Y = 0;
+				for (const auto& Col : Row.Cols)
+				{
+					Function(FIntVector(X, Y, Z), FIntVector(MaxX, Y + Col.Span - 1, MaxZ),
+					         Col.BlockId);
+					Y += Col.Span;
+				}
+
+				X += Row.Span;
 			}
 
-			Index += Layer.Span;
+			Z += Layer.Span;
+		}
+	}
+
+	uint32 Get(const uint8 X, const uint8 Y, const uint8 Z) const
+	{
+		if (IsUniform())
+		{
+			return BlockId;
 		}
 
-		return 0;
+		uint8 LayerZ;
+		const int32 LayerIdx = FSpanArray::Find(Layers, SpanStarts, Z, LayerZ);
+		return LayerIdx != INDEX_NONE ? Layers[LayerIdx].GetXY(X, Y) : 0;
 	}
 
 	TFindResult<FHierarchicalLayer> FindLayer(const uint8 LayerZ) const
@@ -118,19 +381,24 @@ struct FHierarchicalGrid
 			};
 		}
 
-		uint8 CurLayerZ = 0;
-		for (uint8 CurLayerIdx = 0; CurLayerIdx < Layers.Num(); CurLayerIdx++)
+		uint8 CurLayerZ;
+		const int32 LayerIdx = FSpanArray::Find(Layers, SpanStarts, LayerZ, CurLayerZ);
+		if (LayerIdx != INDEX_NONE)
 		{
-			FHierarchicalLayer* Layer = const_cast<FHierarchicalLayer*>(&Layers[CurLayerIdx]);
-			if (CurLayerZ + Layer->Span - 1 >= LayerZ)
-			{
-				return TFindResult{CurLayerZ, CurLayerIdx, Layer};
-			}
-
-			CurLayerZ += Layer->Span;
+			return TFindResult<FHierarchicalLayer>(
+				CurLayerZ, LayerIdx, const_cast<FHierarchicalLayer*>(&Layers[LayerIdx]));
 		}
 
 		checkf(false, TEXT("LayerZ %d not found"), LayerZ);
 		return TFindResult<FHierarchicalLayer>{};
 	}
 };
+
+template <>
+struct TStructOpsTypeTraits<FHierarchicalGrid> : TStructOpsTypeTraitsBase2<FHierarchicalGrid>
+{
+	enum
+	{
+		WithSerializer = true,
+	};
+};
@@ -4,10 +4,16 @@
 #include "HierarchialRow.h"
 #include "FindResult.h"
 #include "Split.h"
+#include "SpanArray.h"
 #include "HierarchialLayer.generated.h"
 
 struct FGameConstants;
 
+/**
+ * Like FHierarchicalColArray, the common case of a few rows lives inside the layer
+ */
+using FHierarchicalRowArray = TArray<FHierarchicalRow, TInlineAllocator<4>>;
+
 USTRUCT(BlueprintType)
 struct FHierarchicalLayer
 {
@@ -23,7 +29,7 @@ struct FHierarchicalLayer
 	{
 	}
 
-	explicit FHierarchicalLayer(const TArray<FHierarchicalRow>& InRows,
+	explicit FHierarchicalLayer(const FHierarchicalRowArray& InRows,
 	                            const uint8 InResolution = FGameConstants::ChunkSize) :
 		Resolution(InResolution), Rows(InRows)
 	{
@@ -39,8 +45,18 @@ struct FHierarchicalLayer
 	UPROPERTY()
 	uint8 Resolution = FGameConstants::ChunkSize;
 
-	UPROPERTY()
-	TArray<FHierarchicalRow> Rows;
+	// Not a UPROPERTY, reflection doesn't support inline allocators, see Serialize
+	FHierarchicalRowArray Rows;
+
+	/**
+	 * Bit N is set when a row starts at X = N, see FHierarchicalRow::SpanStarts
+	 */
+	uint16 SpanStarts = 0;
+
+	void RebuildSpanStarts()
+	{
+		SpanStarts = FSpanArray::BuildStarts(Rows);
+	}
 
 	/**
 	 * Check if the layer is uniform, meaning it is formed by a single block
@@ -50,6 +66,115 @@ struct FHierarchicalLayer
 		return Rows.Num() == 0 && BlockId != -1;
 	}
 
+	bool Serialize(FArchive& Ar)
+	{
+		Ar << Span << BlockId << Resolution << Rows;
+		if (Ar.IsLoading())
+		{
+			RebuildSpanStarts();
+		}
+
+		return true;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FHierarchicalLayer& Layer)
+	{
+		Layer.Serialize(Ar);
+		return Ar;
+	}
+
+	/**
+	 * Heap memory owned by the layer and its rows, whatever is stored inline doesn't count
+	 */
+	SIZE_T GetAllocatedSize() const
+	{
+		SIZE_T Size = Rows.GetAllocatedSize();
+		for (const auto& Row : Rows)
+		{
+			Size += Row.GetAllocatedSize();
+		}
+
+		return Size;
+	}
+
+	int32 NumSpans() const
+	{
+		if (IsUniform())
+		{
+			return 1;
+		}
+
+		int32 Spans = 0;
+		for (const auto& Row : Rows)
+		{
+			Spans += Row.NumSpans();
+		}
+
+		return Spans;
+	}
+
+	bool HasSameContent(const FHierarchicalLayer& Other) const
+	{
+		return BlockId == Other.BlockId && Rows == Other.Rows;
+	}
+
+	bool operator==(const FHierarchicalLayer& Other) const
+	{
+		return Span == Other.Span && HasSameContent(Other);
+	}
+
+	/**
+	 * Set every block of the rectangle (inclusive bounds), splitting rows only at its
+	 * edges and merging them back afterward
+	 */
+	void FillRect(const uint8 MinX, const uint8 MinY, const uint8 MaxX, const uint8 MaxY,
+	              const uint32 InBlockId)
+	{
+		checkf(MinX <= MaxX && MaxX < Resolution, TEXT("Invalid rows %d-%d"), MinX, MaxX);
+
+		if (MinX == 0 && MinY == 0 && MaxX == Resolution - 1 && MaxY == Resolution - 1)
+		{
+			Rows.Empty();
+			BlockId = InBlockId;
+			return;
+		}
+
+		if (IsUniform())
+		{
+			if (BlockId == InBlockId)
+			{
+				return;
+			}
+
+			Rows.Add(FHierarchicalRow{Resolution, BlockId, Resolution});
+			BlockId = -1;
+		}
+
+		const int32 First = FSpanArray::SplitAt(Rows, MinX);
+		const int32 End = FSpanArray::SplitAt(Rows, MaxX + 1);
+		for (int32 RowIdx = First; RowIdx < End; RowIdx++)
+		{
+			Rows[RowIdx].FillSpan(MinY, MaxY, InBlockId);
+		}
+
+		FSpanArray::Coalesce(Rows, First, End - 1);
+
+		CollapseIfUniform();
+		RebuildSpanStarts();
+	}
+
+	/**
+	 * Turn back into a uniform layer when a single uniform row is left
+	 */
+	void CollapseIfUniform()
+	{
+		if (Rows.Num() == 1 && Rows[0].IsUniform())
+		{
+			BlockId = Rows[0].BlockId;
+			Rows.Empty();
+		}
+	}
+
 	void Set(const uint32 InBlockId, const uint8 X, const uint8 Y)
 	{
 		auto Result = FindRow(X);
@@ -67,17 +192,59 @@ struct FHierarchicalLayer
 				Rows.RemoveAt(Result.StartIdx);
 			}
 
-			// The problem is here!
 			Rows.Insert(SplitRows.All(), Result.StartIdx);
-			// The problem is here!
-			
-			// BlockId = -1;
-			//
-			// const auto Offset = SplitRows.Before.IsSet() ? 1 : 0;
-			// Row = &Rows[Result.StartIdx + Offset];
+			BlockId = -1;
+			RebuildSpanStarts();
+
+			// Result pointed into the rows (or at a copy, for a uniform layer), take the
+			// inserted unit row instead
+			const auto Offset = SplitRows.Before.IsSet() ? 1 : 0;
+			Row = &Rows[Result.StartIdx + Offset];
 		}
 
-		// Row->Set(InBlockId, Y);
+		Row->Set(InBlockId, Y);
+	}
+
+	/**
+	 * Write edits of this layer, sorted by X then Y, one row at a time, then merge the rows
+	 * back
+	 */
+	void ApplyEdits(const TConstArrayView<FBlockEdit> Edits)
+	{
+		if (IsUniform())
+		{
+			Rows.Add(FHierarchicalRow{Resolution, BlockId, Resolution});
+			BlockId = -1;
+		}
+
+		int32 First = 0;
+		while (First < Edits.Num())
+		{
+			const uint8 X = Edits[First].X;
+			int32 End = First + 1;
+			while (End < Edits.Num() && Edits[End].X == X)
+			{
+				End++;
+			}
+
+			const int32 RowIdx = FSpanArray::SplitAt(Rows, X);
+			FSpanArray::SplitAt(Rows, X + 1);
+			Rows[RowIdx].ApplyEdits(Edits.Slice(First, End - First));
+			First = End;
+		}
+
+		MergeRows();
+	}
+
+	/**
+	 * Merge adjacent rows with the same content, uniform or not, and collapse to uniform if a
+	 * single uniform row is left
+	 */
+	void MergeRows()
+	{
+		FSpanArray::Merge(Rows);
+		CollapseIfUniform();
+		RebuildSpanStarts();
 	}
 
 	TSplit<FHierarchicalLayer> Split(const uint8 At,
@@ -129,20 +296,15 @@ struct FHierarchicalLayer
 				0, 0, FHierarchicalRow(Resolution, BlockId, Resolution));
 		}
 
-		int CurRowX = 0;
-		for (int CurIdx = 0; CurIdx < Rows.Num(); CurIdx++)
+		uint8 CurRowX;
+		const int32 RowIdx = FSpanArray::Find(Rows, SpanStarts, RowX, CurRowX);
+		if (RowIdx == INDEX_NONE)
 		{
-			FHierarchicalRow* Row = const_cast<FHierarchicalRow*>(&Rows[CurIdx]);
-
-			if (CurRowX + Row->Span - 1 >= RowX)
-			{
-				return TFindResult(CurRowX, CurIdx, Row);
-			}
-
-			CurRowX += Row->Span;
+			return TFindResult<FHierarchicalRow>();
 		}
 
-		return TFindResult<FHierarchicalRow>();
+		return TFindResult<FHierarchicalRow>(
+			CurRowX, RowIdx, const_cast<FHierarchicalRow*>(&Rows[RowIdx]));
 	}
 
 	/**
@@ -177,62 +339,23 @@ struct FHierarchicalLayer
 		return FHierarchicalRow();
 	}
 
-	// TODO check performance
-	// TODO use interface instead? (so merge row and merge col and merge layer has the implementation)
+	/**
+	 * Merge adjacent layers with the same content, uniform or not, see FSpanArray::Merge.
+	 * Layers is moved into the result
+	 */
 	static TArray<FHierarchicalLayer> MergeLayers(TArray<FHierarchicalLayer>& Layers)
 	{
-		if (Layers.Num() == 0)
-		{
-			return {};
-		}
-
-		const auto Resolution = Layers[0].Resolution;
-		TArray<FHierarchicalLayer> Merged;
-
-		uint32 LastBlockId = -1;
-		uint8 LastSize = 0;
-
-		for (int LayerIdx = 0; LayerIdx < Layers.Num(); LayerIdx++)
-		{
-			auto& Layer = Layers[LayerIdx];
-
-			if (Layer.IsUniform())
-			{
-				if (LastBlockId == -1)
-				{
-					LastBlockId = Layer.BlockId;
-				}
-
-				if (Layer.BlockId == LastBlockId)
-				{
-					LastSize += Layer.Span;
-				}
-				else
-				{
-					Merged.Add(FHierarchicalLayer{LastSize, LastBlockId, Resolution});
-					LastBlockId = Layer.BlockId;
-					LastSize = Layer.Span;
-				}
-			}
-			else
-			{
-				if (LastSize != 0 && LastBlockId != -1)
-				{
-					Merged.Add(FHierarchicalLayer{LastSize, LastBlockId, Resolution});
-					LastBlockId = -1;
-					LastSize = 0;
-				}
-
-				Merged.Add(MoveTemp(Layer));
-			}
-
-			// Is Last, add accumulated
-			if (LayerIdx == Layers.Num() - 1 && LastSize != 0 && LastBlockId != -1)
-			{
-				Merged.Add(FHierarchicalLayer{LastSize, LastBlockId, Resolution});
-			}
-		}
-
+		TArray<FHierarchicalLayer> Merged = MoveTemp(Layers);
+		FSpanArray::Merge(Merged);
 		return Merged;
 	}
 };
+
+template <>
+struct TStructOpsTypeTraits<FHierarchicalLayer> : TStructOpsTypeTraitsBase2<FHierarchicalLayer>
+{
+	enum
+	{
+		WithSerializer = true,
+	};
+};
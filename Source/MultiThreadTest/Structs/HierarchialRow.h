@@ -2,13 +2,20 @@
 
 #include "CoreMinimal.h"
 #include "HierarchicalCol.h"
+#include "BlockEdit.h"
 #include "FindResult.h"
 #include "Split.h"
+#include "SpanArray.h"
 #include "MultiThreadTest/Constants/GameConstants.h"
 #include "HierarchialRow.generated.h"
 
 struct FGameConstants;
 
+/**
+ * Most rows hold a handful of cols, keep up to 4 of them inside the row itself
+ */
+using FHierarchicalColArray = TArray<FHierarchicalCol, TInlineAllocator<4>>;
+
 /**
  * Rows grows in the Y axis (right vector)
  * So, rows are indexed by X (first row is X=0)
@@ -30,7 +37,7 @@ struct FHierarchicalRow
 	{
 	}
 
-	explicit FHierarchicalRow(const TArray<FHierarchicalCol>& InCols,
+	explicit FHierarchicalRow(const FHierarchicalColArray& InCols,
 	                          const uint8 InResolution = FGameConstants::ChunkSize) :
 		Resolution(InResolution), Cols(InCols)
 	{
@@ -45,8 +52,20 @@ struct FHierarchicalRow
 	UPROPERTY()
 	uint8 Resolution = FGameConstants::ChunkSize;
 
-	UPROPERTY()
-	TArray<FHierarchicalCol> Cols;
+	// Not a UPROPERTY, reflection doesn't support inline allocators, see Serialize
+	FHierarchicalColArray Cols;
+
+	/**
+	 * Bit N is set when a col starts at Y = N, so lookups don't walk the cols. Rebuilt by
+	 * everything that changes Cols, 0 means not built (e.g. after reflection serialization)
+	 * and lookups fall back to walking the cols
+	 */
+	uint16 SpanStarts = 0;
+
+	void RebuildSpanStarts()
+	{
+		SpanStarts = FSpanArray::BuildStarts(Cols);
+	}
 
 	/**
 	 * Check if the layer is uniform, meaning it is formed by a single block
@@ -56,6 +75,127 @@ struct FHierarchicalRow
 		return Cols.Num() == 0 && BlockId != -1;
 	}
 
+	bool Serialize(FArchive& Ar)
+	{
+		Ar << Span << BlockId << Resolution << Cols;
+		if (Ar.IsLoading())
+		{
+			RebuildSpanStarts();
+		}
+
+		return true;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FHierarchicalRow& Row)
+	{
+		Row.Serialize(Ar);
+		return Ar;
+	}
+
+	/**
+	 * Heap memory owned by the row, cols stored inline don't count
+	 */
+	SIZE_T GetAllocatedSize() const
+	{
+		return Cols.GetAllocatedSize();
+	}
+
+	int32 NumSpans() const
+	{
+		return IsUniform() ? 1 : Cols.Num();
+	}
+
+	bool HasSameContent(const FHierarchicalRow& Other) const
+	{
+		return BlockId == Other.BlockId && Cols == Other.Cols;
+	}
+
+	bool operator==(const FHierarchicalRow& Other) const
+	{
+		return Span == Other.Span && HasSameContent(Other);
+	}
+
+	/**
+	 * Set every block from MinY to MaxY (inclusive), writing the run directly instead of
+	 * going block by block
+	 */
+	void FillSpan(const uint8 MinY, const uint8 MaxY, const uint32 InBlockId)
+	{
+		checkf(MinY <= MaxY && MaxY < Resolution, TEXT("Invalid span %d-%d"), MinY, MaxY);
+
+		if (MinY == 0 && MaxY == Resolution - 1)
+		{
+			Cols.Empty();
+			BlockId = InBlockId;
+			return;
+		}
+
+		if (IsUniform())
+		{
+			if (BlockId == InBlockId)
+			{
+				return;
+			}
+
+			Cols.Add(FHierarchicalCol{Resolution, BlockId});
+			BlockId = -1;
+		}
+
+		const int32 First = FSpanArray::SplitAt(Cols, MinY);
+		const int32 End = FSpanArray::SplitAt(Cols, MaxY + 1);
+		Cols.RemoveAt(First, End - First);
+		Cols.Insert(FHierarchicalCol{static_cast<uint8>(MaxY - MinY + 1), InBlockId}, First);
+		FSpanArray::Coalesce(Cols, First, First);
+
+		CollapseIfUniform();
+		RebuildSpanStarts();
+	}
+
+	/**
+	 * Turn back into a uniform row when a single col is left
+	 */
+	void CollapseIfUniform()
+	{
+		if (Cols.Num() == 1)
+		{
+			BlockId = Cols[0].BlockId;
+			Cols.Empty();
+		}
+	}
+
+	/**
+	 * Write edits of this row, sorted by Y, then merge the cols back. Edits at the same Y are
+	 * applied in order, the last one wins
+	 */
+	void ApplyEdits(const TConstArrayView<FBlockEdit> Edits)
+	{
+		if (IsUniform())
+		{
+			Cols.Add(FHierarchicalCol{Resolution, BlockId});
+			BlockId = -1;
+		}
+
+		for (const auto& Edit : Edits)
+		{
+			const int32 ColIdx = FSpanArray::SplitAt(Cols, Edit.Y);
+			FSpanArray::SplitAt(Cols, Edit.Y + 1);
+			Cols[ColIdx].BlockId = Edit.BlockId;
+		}
+
+		MergeCols();
+	}
+
+	/**
+	 * Merge adjacent cols holding the same block, and collapse to uniform if a single one is
+	 * left
+	 */
+	void MergeCols()
+	{
+		FSpanArray::Merge(Cols);
+		CollapseIfUniform();
+		RebuildSpanStarts();
+	}
+
 	void Set(const uint32 InBlockId, const uint8 Y)
 	{
 		auto Result = FindCol(Y);
@@ -74,6 +214,7 @@ struct FHierarchicalRow
 
 			Cols.Insert(SplitCols.All(), Result.StartIdx);
 			BlockId = -1;
+			RebuildSpanStarts();
 
 			const auto Offset = SplitCols.Before.IsSet() ? 1 : 0;
 			Col = &Cols[Result.StartIdx + Offset];
@@ -91,19 +232,14 @@ struct FHierarchicalRow
 				0, 0, FHierarchicalCol(Resolution, BlockId));
 		}
 
-		int CurColY = 0;
-		for (int CurIdx = 0; CurIdx < Cols.Num(); CurIdx++)
+		uint8 ColY;
+		const int32 ColIdx = FSpanArray::Find(Cols, SpanStarts, Y, ColY);
+		if (ColIdx == INDEX_NONE)
 		{
-			FHierarchicalCol* Col = &Cols[CurIdx];
-			if (CurColY + Col->Span - 1 >= Y)
-			{
-				return TFindResult(CurColY, CurIdx, Col);
-			}
-
-			CurColY += Col->Span;
+			return TFindResult<FHierarchicalCol>();
 		}
 
-		return TFindResult<FHierarchicalCol>();
+		return TFindResult<FHierarchicalCol>(ColY, ColIdx, &Cols[ColIdx]);
 	}
 
 	TSplit<FHierarchicalRow> Split(const uint8 At,
@@ -137,15 +273,11 @@ struct FHierarchicalRow
 			return FHierarchicalCol{1, BlockId};
 		}
 
-		int Index = 0;
-		for (const auto& Col : Cols)
+		uint8 ColY;
+		const int32 ColIdx = FSpanArray::Find(Cols, SpanStarts, X, ColY);
+		if (ColIdx != INDEX_NONE)
 		{
-			if (Index + Col.Span - 1 >= X)
-			{
-				return {1, Col.BlockId};
-			}
-
-			Index += Col.Span;
+			return {1, Cols[ColIdx].BlockId};
 		}
 
 		checkf(false, TEXT("Couldn't find X %d in row"), X);
@@ -159,17 +291,17 @@ struct FHierarchicalRow
 			return BlockId;
 		}
 
-		int ColY = 0;
-		for (const auto& Col : Cols)
-		{
-			if (ColY + Col.Span - 1 >= Y)
-			{
-				return Col.BlockId;
-			}
-
-			ColY += Col.Span;
-		}
-
-		return 0;
+		uint8 ColY;
+		const int32 ColIdx = FSpanArray::Find(Cols, SpanStarts, Y, ColY);
+		return ColIdx != INDEX_NONE ? Cols[ColIdx].BlockId : 0;
 	}
 };
+
+template <>
+struct TStructOpsTypeTraits<FHierarchicalRow> : TStructOpsTypeTraitsBase2<FHierarchicalRow>
+{
+	enum
+	{
+		WithSerializer = true,
+	};
+};
@@ -32,6 +32,29 @@ struct FHierarchicalCol
 		return Span != 0 && BlockId != -1;
 	}
 
+	/**
+	 * A col is always a single span, see FHierarchicalGrid::NumSpans
+	 */
+	int32 NumSpans() const
+	{
+		return 1;
+	}
+
+	bool HasSameContent(const FHierarchicalCol& Other) const
+	{
+		return BlockId == Other.BlockId;
+	}
+
+	bool operator==(const FHierarchicalCol& Other) const
+	{
+		return Span == Other.Span && BlockId == Other.BlockId;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FHierarchicalCol& Col)
+	{
+		return Ar << Col.Span << Col.BlockId;
+	}
+
 	TSplit<FHierarchicalCol> Split(const uint8 At,
 	                               const uint8 ThisColY) const
 	{
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "DenseBlockBuffer.h"
+#include "HierarchialGrid.h"
+
+/**
+ * Converts between FDenseBlockBuffer and FHierarchicalGrid
+ */
+struct FHierarchicalDenseCodec
+{
+	/**
+	 * Encode the buffer in one linear pass. Cols are run length encoded, and identical
+	 * neighbour rows and layers are merged as they are produced (a row or layer equal to
+	 * the previous one is detected with a memcmp before encoding it). Whatever ends up
+	 * with a single uniform child collapses to uniform, like FHierarchicalLayer::MergeLayers
+	 */
+	static void Encode(const FDenseBlockBuffer& Buffer, FHierarchicalGrid& OutGrid)
+	{
+		const uint8 Resolution = Buffer.Resolution;
+		const int32 RowSize = Resolution;
+		const int32 LayerSize = Resolution * Resolution;
+		const uint32* Blocks = Buffer.Blocks.GetData();
+
+		OutGrid.Resolution = Resolution;
+		OutGrid.BlockId = -1;
+		OutGrid.Layers.Reset();
+
+		for (int32 Z = 0; Z < Resolution; Z++)
+		{
+			const uint32* LayerBlocks = Blocks + Z * LayerSize;
+			if (Z > 0 && FMemory::Memcmp(LayerBlocks, LayerBlocks - LayerSize,
+			                             LayerSize * sizeof(uint32)) == 0)
+			{
+				OutGrid.Layers.Last().Span++;
+				continue;
+			}
+
+			FHierarchicalLayer& Layer = OutGrid.Layers.AddDefaulted_GetRef();
+			Layer.Resolution = Resolution;
+
+			for (int32 X = 0; X < Resolution; X++)
+			{
+				const uint32* RowBlocks = LayerBlocks + X * RowSize;
+				if (X > 0 && FMemory::Memcmp(RowBlocks, RowBlocks - RowSize,
+				                             RowSize * sizeof(uint32)) == 0)
+				{
+					Layer.Rows.Last().Span++;
+					continue;
+				}
+
+				FHierarchicalRow& Row = Layer.Rows.AddDefaulted_GetRef();
+				Row.Resolution = Resolution;
+
+				int32 RunStart = 0;
+				for (int32 Y = 1; Y <= Resolution; Y++)
+				{
+					if (Y == Resolution || RowBlocks[Y] != RowBlocks[RunStart])
+					{
+						Row.Cols.Add(FHierarchicalCol{
+							static_cast<uint8>(Y - RunStart), RowBlocks[RunStart]
+						});
+						RunStart = Y;
+					}
+				}
+
+				Row.CollapseIfUniform();
+				Row.RebuildSpanStarts();
+			}
+
+			Layer.CollapseIfUniform();
+			Layer.RebuildSpanStarts();
+		}
+
+		if (OutGrid.Layers.Num() == 1 && OutGrid.Layers[0].IsUniform())
+		{
+			OutGrid.BlockId = OutGrid.Layers[0].BlockId;
+			OutGrid.Layers.Empty();
+		}
+
+		OutGrid.RebuildSpanStarts();
+	}
+
+	/**
+	 * Expand the grid back to dense. Every span turns into contiguous constant stores, and
+	 * repeated rows and layers into memcpys of the first one
+	 */
+	static void Decode(const FHierarchicalGrid& Grid, FDenseBlockBuffer& OutBuffer)
+	{
+		const uint8 Resolution = Grid.Resolution;
+		const int32 RowSize = Resolution;
+		const int32 LayerSize = Resolution * Resolution;
+
+		OutBuffer.Resolution = Resolution;
+		OutBuffer.Blocks.SetNumUninitialized(LayerSize * Resolution);
+		uint32* Blocks = OutBuffer.Blocks.GetData();
+
+		if (Grid.IsUniform())
+		{
+			FDenseBlockBuffer::Fill(Blocks, LayerSize * Resolution, Grid.BlockId);
+			return;
+		}
+
+		int32 Z = 0;
+		for (const auto& Layer : Grid.Layers)
+		{
+			uint32* LayerBlocks = Blocks + Z * LayerSize;
+			if (Layer.IsUniform())
+			{
+				FDenseBlockBuffer::Fill(LayerBlocks, LayerSize * Layer.Span, Layer.BlockId);
+				Z += Layer.Span;
+				continue;
+			}
+
+			int32 X = 0;
+			for (const auto& Row : Layer.Rows)
+			{
+				uint32* RowBlocks = LayerBlocks + X * RowSize;
+				if (Row.IsUniform())
+				{
+					FDenseBlockBuffer::Fill(RowBlocks, RowSize * Row.Span, Row.BlockId);
+					X += Row.Span;
+					continue;
+				}
+
+				int32 Y = 0;
+				for (const auto& Col : Row.Cols)
+				{
+					FDenseBlockBuffer::Fill(RowBlocks + Y, Col.Span, Col.BlockId);
+					Y += Col.Span;
+				}
+
+				for (int32 Copy = 1; Copy < Row.Span; Copy++)
+				{
+					FMemory::Memcpy(RowBlocks + Copy * RowSize, RowBlocks, RowSize * sizeof(uint32));
+				}
+
+				X += Row.Span;
+			}
+
+			for (int32 Copy = 1; Copy < Layer.Span; Copy++)
+			{
+				FMemory::Memcpy(LayerBlocks + Copy * LayerSize, LayerBlocks,
+				                LayerSize * sizeof(uint32));
+			}
+
+			Z += Layer.Span;
+		}
+	}
+};
@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HierarchicalDenseCodec.h"
+
+/**
+ * Builds a lower resolution copy of a grid, for LoD sections.
+ *
+ * Each voxel of the result covers Factor³ source blocks. It is solid when at least half of
+ * them are, with the most common solid block of the cell, so thin features vanish before
+ * the silhouette moves. Block 0 is air.
+ */
+struct FHierarchicalDownsampler
+{
+	static void Downsample(const FHierarchicalGrid& Source, const uint8 TargetResolution,
+	                       FHierarchicalGrid& OutGrid)
+	{
+		checkf(FMath::IsPowerOfTwo(TargetResolution) && TargetResolution <= Source.Resolution,
+		       TEXT("Can't downsample %d to %d"), Source.Resolution, TargetResolution);
+
+		if (Source.IsUniform())
+		{
+			OutGrid = FHierarchicalGrid{Source.BlockId, TargetResolution};
+			return;
+		}
+
+		if (TargetResolution == Source.Resolution)
+		{
+			OutGrid = Source;
+			return;
+		}
+
+		const auto SourceBuffer = FDenseBlockBuffer::Acquire(Source.Resolution);
+		FHierarchicalDenseCodec::Decode(Source, *SourceBuffer);
+
+		const auto TargetBuffer = FDenseBlockBuffer::Acquire(TargetResolution);
+		const int32 Factor = Source.Resolution / TargetResolution;
+		const int32 CellSize = Factor * Factor * Factor;
+
+		for (int32 Z = 0; Z < TargetResolution; Z++)
+		{
+			for (int32 X = 0; X < TargetResolution; X++)
+			{
+				for (int32 Y = 0; Y < TargetResolution; Y++)
+				{
+					TargetBuffer->Set(X, Y, Z, ReduceCell(*SourceBuffer, X * Factor, Y * Factor,
+					                                      Z * Factor, Factor, CellSize));
+				}
+			}
+		}
+
+		FHierarchicalDenseCodec::Encode(*TargetBuffer, OutGrid);
+	}
+
+private:
+	static uint32 ReduceCell(const FDenseBlockBuffer& Buffer, const int32 MinX,
+	                         const int32 MinY, const int32 MinZ, const int32 Factor,
+	                         const int32 CellSize)
+	{
+		// Cells hold very few distinct blocks, a linear search beats a map
+		TArray<TPair<uint32, int32>, TInlineAllocator<8>> Counts;
+		int32 Solid = 0;
+
+		for (int32 Z = MinZ; Z < MinZ + Factor; Z++)
+		{
+			for (int32 X = MinX; X < MinX + Factor; X++)
+			{
+				const uint32* Row = Buffer.Blocks.GetData() + Buffer.Index(X, MinY, Z);
+				for (int32 Y = 0; Y < Factor; Y++)
+				{
+					const uint32 Block = Row[Y];
+					if (!Block)
+					{
+						continue;
+					}
+
+					Solid++;
+					auto* Count = Counts.FindByPredicate([Block](const TPair<uint32, int32>& Pair)
+					{
+						return Pair.Key == Block;
+					});
+
+					if (Count)
+					{
+						Count->Value++;
+					}
+					else
+					{
+						Counts.Emplace(Block, 1);
+					}
+				}
+			}
+		}
+
+		if (Solid * 2 < CellSize)
+		{
+			return 0;
+		}
+
+		const TPair<uint32, int32>* Best = &Counts[0];
+		for (const auto& Count : Counts)
+		{
+			Best = Count.Value > Best->Value ? &Count : Best;
+		}
+
+		return Best->Key;
+	}
+};
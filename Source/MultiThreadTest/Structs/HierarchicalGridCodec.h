@@ -0,0 +1,421 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "DenseBlockBuffer.h"
+#include "HierarchialGrid.h"
+
+/**
+ * Compact binary encoding of a FHierarchicalGrid, versioned and independent from the
+ * struct layout (unlike Serialize, which writes every field as is).
+ *
+ * Everything is a LEB128 varint: version, resolution, then the palette of the distinct
+ * block ids of the grid, then the hierarchy depth first. Each node is its child count
+ * followed either by a palette index (0 children, uniform) or by every child as its span
+ * and its own node. Cols are always leaves, so they are a span and a palette index.
+ */
+struct FHierarchicalGridCodec
+{
+	static constexpr uint8 Version = 1;
+
+	/**
+	 * Widest LEB128 encoding of a uint32
+	 */
+	static constexpr int32 MaxVarintSize = 5;
+
+	/**
+	 * Largest encoding of a full resolution grid: every block distinct, every col its own
+	 * child and every varint at its widest
+	 */
+	static constexpr int32 MaxEncodedSize = MaxVarintSize * (
+		3 + FGameConstants::ChunkSize * FGameConstants::ChunkSize * FGameConstants::ChunkSize +
+		1 + 2 * FGameConstants::ChunkSize +
+		2 * FGameConstants::ChunkSize * FGameConstants::ChunkSize +
+		2 * FGameConstants::ChunkSize * FGameConstants::ChunkSize * FGameConstants::ChunkSize);
+
+	/**
+	 * Grids rarely hold more than a handful of distinct blocks
+	 */
+	using FPalette = TArray<uint32, TInlineAllocator<16>>;
+
+	struct FReader
+	{
+		FReader(const uint8* InData, const int32 InNum) : Ptr(InData), End(InData + InNum)
+		{
+		}
+
+		explicit FReader(const TConstArrayView<uint8> Data) : FReader(Data.GetData(), Data.Num())
+		{
+		}
+
+		const uint8* Ptr;
+
+		const uint8* End;
+
+		/**
+		 * Set when reading past the end or hitting invalid data, reads then return 0
+		 */
+		bool bError = false;
+
+		uint32 ReadVarint()
+		{
+			uint32 Value = 0;
+			for (int32 Shift = 0; Shift < 35; Shift += 7)
+			{
+				if (Ptr == End)
+				{
+					bError = true;
+					return 0;
+				}
+
+				const uint8 Byte = *Ptr++;
+				Value |= static_cast<uint32>(Byte & 0x7F) << Shift;
+				if (!(Byte & 0x80))
+				{
+					return Value;
+				}
+			}
+
+			bError = true;
+			return 0;
+		}
+	};
+
+	static void WriteVarint(TArray<uint8>& Out, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.Add(static_cast<uint8>(Value | 0x80));
+			Value >>= 7;
+		}
+
+		Out.Add(static_cast<uint8>(Value));
+	}
+
+	static void Encode(const FHierarchicalGrid& Grid, TArray<uint8>& Out)
+	{
+		FPalette Palette;
+		CollectPalette(Grid, Palette);
+
+		WriteVarint(Out, Version);
+		WriteVarint(Out, Grid.Resolution);
+		WriteVarint(Out, Palette.Num());
+		for (const uint32 Block : Palette)
+		{
+			WriteVarint(Out, Block);
+		}
+
+		WriteVarint(Out, Grid.Layers.Num());
+		if (Grid.Layers.IsEmpty())
+		{
+			WriteVarint(Out, Palette.Find(Grid.BlockId));
+			return;
+		}
+
+		for (const auto& Layer : Grid.Layers)
+		{
+			WriteVarint(Out, Layer.Span);
+			WriteVarint(Out, Layer.Rows.Num());
+			if (Layer.Rows.IsEmpty())
+			{
+				WriteVarint(Out, Palette.Find(Layer.BlockId));
+				continue;
+			}
+
+			for (const auto& Row : Layer.Rows)
+			{
+				WriteVarint(Out, Row.Span);
+				WriteVarint(Out, Row.Cols.Num());
+				if (Row.Cols.IsEmpty())
+				{
+					WriteVarint(Out, Palette.Find(Row.BlockId));
+					continue;
+				}
+
+				for (const auto& Col : Row.Cols)
+				{
+					WriteVarint(Out, Col.Span);
+					WriteVarint(Out, Palette.Find(Col.BlockId));
+				}
+			}
+		}
+	}
+
+	/**
+	 * Decode in place, the layer array of OutGrid keeps its allocation and rows and cols
+	 * are built directly in their (mostly inline) storage
+	 */
+	static bool Decode(FReader& Reader, FHierarchicalGrid& OutGrid)
+	{
+		FPalette Palette;
+		uint8 Resolution;
+		if (!ReadHeader(Reader, Resolution, Palette))
+		{
+			return false;
+		}
+
+		OutGrid.Resolution = Resolution;
+		OutGrid.BlockId = -1;
+		OutGrid.Layers.Reset();
+
+		const uint32 LayerCount = ReadChildCount(Reader, Resolution);
+		if (LayerCount == 0)
+		{
+			OutGrid.BlockId = ReadBlock(Reader, Palette);
+			OutGrid.RebuildSpanStarts();
+			return !Reader.bError;
+		}
+
+		OutGrid.Layers.AddDefaulted(LayerCount);
+		int32 Z = 0;
+		for (auto& Layer : OutGrid.Layers)
+		{
+			Layer.Resolution = Resolution;
+			Layer.Span = ReadSpan(Reader, Z, Resolution);
+
+			const uint32 RowCount = ReadChildCount(Reader, Resolution);
+			if (RowCount == 0)
+			{
+				Layer.BlockId = ReadBlock(Reader, Palette);
+				continue;
+			}
+
+			Layer.Rows.AddDefaulted(RowCount);
+			int32 X = 0;
+			for (auto& Row : Layer.Rows)
+			{
+				Row.Resolution = Resolution;
+				Row.Span = ReadSpan(Reader, X, Resolution);
+
+				const uint32 ColCount = ReadChildCount(Reader, Resolution);
+				if (ColCount == 0)
+				{
+					Row.BlockId = ReadBlock(Reader, Palette);
+					continue;
+				}
+
+				Row.Cols.AddUninitialized(ColCount);
+				int32 Y = 0;
+				for (auto& Col : Row.Cols)
+				{
+					Col.Span = ReadSpan(Reader, Y, Resolution);
+					Col.BlockId = ReadBlock(Reader, Palette);
+				}
+
+				Reader.bError |= Y != Resolution;
+				Row.RebuildSpanStarts();
+			}
+
+			Reader.bError |= X != Resolution;
+			Layer.RebuildSpanStarts();
+		}
+
+		Reader.bError |= Z != Resolution;
+		OutGrid.RebuildSpanStarts();
+		return !Reader.bError;
+	}
+
+	/**
+	 * Decode straight into a dense buffer (e.g. a pooled one), without building the grid.
+	 * Repeated layers and rows are decoded once and copied
+	 */
+	static bool Decode(FReader& Reader, FDenseBlockBuffer& OutBuffer)
+	{
+		FPalette Palette;
+		uint8 Resolution;
+		if (!ReadHeader(Reader, Resolution, Palette))
+		{
+			return false;
+		}
+
+		const int32 RowSize = Resolution;
+		const int32 LayerSize = Resolution * Resolution;
+		OutBuffer.Resolution = Resolution;
+		OutBuffer.Blocks.SetNumUninitialized(LayerSize * Resolution);
+		uint32* Blocks = OutBuffer.Blocks.GetData();
+
+		const uint32 LayerCount = ReadChildCount(Reader, Resolution);
+		if (LayerCount == 0)
+		{
+			FDenseBlockBuffer::Fill(Blocks, OutBuffer.Blocks.Num(), ReadBlock(Reader, Palette));
+			return !Reader.bError;
+		}
+
+		// Spans are validated before anything is written, so a corrupted input can't write
+		// out of the buffer
+		int32 Z = 0;
+		for (uint32 LayerIdx = 0; LayerIdx < LayerCount; LayerIdx++)
+		{
+			uint32* LayerBlocks = Blocks + Z * LayerSize;
+			const uint8 LayerSpan = ReadSpan(Reader, Z, Resolution);
+
+			const uint32 RowCount = ReadChildCount(Reader, Resolution);
+			if (Reader.bError)
+			{
+				return false;
+			}
+
+			if (RowCount == 0)
+			{
+				FDenseBlockBuffer::Fill(LayerBlocks, LayerSpan * LayerSize,
+				                        ReadBlock(Reader, Palette));
+				continue;
+			}
+
+			int32 X = 0;
+			for (uint32 RowIdx = 0; RowIdx < RowCount; RowIdx++)
+			{
+				uint32* RowBlocks = LayerBlocks + X * RowSize;
+				const uint8 RowSpan = ReadSpan(Reader, X, Resolution);
+
+				const uint32 ColCount = ReadChildCount(Reader, Resolution);
+				if (Reader.bError)
+				{
+					return false;
+				}
+
+				if (ColCount == 0)
+				{
+					FDenseBlockBuffer::Fill(RowBlocks, RowSpan * RowSize, ReadBlock(Reader, Palette));
+					continue;
+				}
+
+				int32 Y = 0;
+				for (uint32 ColIdx = 0; ColIdx < ColCount; ColIdx++)
+				{
+					uint32* ColBlocks = RowBlocks + Y;
+					const uint8 ColSpan = ReadSpan(Reader, Y, Resolution);
+					if (Reader.bError)
+					{
+						return false;
+					}
+
+					FDenseBlockBuffer::Fill(ColBlocks, ColSpan, ReadBlock(Reader, Palette));
+				}
+
+				if (Y != Resolution)
+				{
+					return false;
+				}
+
+				for (int32 Copy = 1; Copy < RowSpan; Copy++)
+				{
+					FMemory::Memcpy(RowBlocks + Copy * RowSize, RowBlocks, RowSize * sizeof(uint32));
+				}
+			}
+
+			if (X != Resolution)
+			{
+				return false;
+			}
+
+			for (int32 Copy = 1; Copy < LayerSpan; Copy++)
+			{
+				FMemory::Memcpy(LayerBlocks + Copy * LayerSize, LayerBlocks,
+				                LayerSize * sizeof(uint32));
+			}
+		}
+
+		return Z == Resolution && !Reader.bError;
+	}
+
+private:
+	static void AddToPalette(FPalette& Palette, const uint32 Block)
+	{
+		Palette.AddUnique(Block);
+	}
+
+	static void CollectPalette(const FHierarchicalGrid& Grid, FPalette& OutPalette)
+	{
+		if (Grid.Layers.IsEmpty())
+		{
+			AddToPalette(OutPalette, Grid.BlockId);
+			return;
+		}
+
+		for (const auto& Layer : Grid.Layers)
+		{
+			if (Layer.Rows.IsEmpty())
+			{
+				AddToPalette(OutPalette, Layer.BlockId);
+				continue;
+			}
+
+			for (const auto& Row : Layer.Rows)
+			{
+				if (Row.Cols.IsEmpty())
+				{
+					AddToPalette(OutPalette, Row.BlockId);
+					continue;
+				}
+
+				for (const auto& Col : Row.Cols)
+				{
+					AddToPalette(OutPalette, Col.BlockId);
+				}
+			}
+		}
+	}
+
+	static bool ReadHeader(FReader& Reader, uint8& OutResolution, FPalette& OutPalette)
+	{
+		const uint32 EncodedVersion = Reader.ReadVarint();
+		const uint32 Resolution = Reader.ReadVarint();
+		const uint32 PaletteSize = Reader.ReadVarint();
+		if (Reader.bError || EncodedVersion == 0 || EncodedVersion > Version ||
+			Resolution == 0 || Resolution > FGameConstants::ChunkSize ||
+			PaletteSize == 0 || PaletteSize > static_cast<uint32>(Reader.End - Reader.Ptr))
+		{
+			Reader.bError = true;
+			return false;
+		}
+
+		OutResolution = static_cast<uint8>(Resolution);
+		OutPalette.SetNumUninitialized(PaletteSize);
+		for (uint32& Block : OutPalette)
+		{
+			Block = Reader.ReadVarint();
+		}
+
+		return !Reader.bError;
+	}
+
+	static uint32 ReadBlock(FReader& Reader, const FPalette& Palette)
+	{
+		const uint32 PaletteIdx = Reader.ReadVarint();
+		if (PaletteIdx >= static_cast<uint32>(Palette.Num()))
+		{
+			Reader.bError = true;
+			return 0;
+		}
+
+		return Palette[PaletteIdx];
+	}
+
+	static uint32 ReadChildCount(FReader& Reader, const uint8 Resolution)
+	{
+		const uint32 Count = Reader.ReadVarint();
+		if (Count > Resolution)
+		{
+			Reader.bError = true;
+			return 0;
+		}
+
+		return Count;
+	}
+
+	/**
+	 * Read a span and advance InOutPos past it, flagging spans that would overflow
+	 */
+	static uint8 ReadSpan(FReader& Reader, int32& InOutPos, const uint8 Resolution)
+	{
+		const uint32 Span = Reader.ReadVarint();
+		if (Span == 0 || InOutPos + Span > Resolution)
+		{
+			Reader.bError = true;
+			return 0;
+		}
+
+		InOutPos += Span;
+		return static_cast<uint8>(Span);
+	}
+};
@@ -0,0 +1,335 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "DenseBlockBuffer.h"
+#include "HierarchialGrid.h"
+#include "HierarchicalDenseCodec.h"
+
+/**
+ * Alternative section storage for noisy sections, where spans barely merge: a small
+ * palette of block ids plus one bit packed palette index per block.
+ *
+ * Indices start at 0 bits (the whole section is Palette[0]) and grow to 1, 2, 4, 8 and
+ * 16 bits as the palette fills up. These all divide 64, so an index never straddles two
+ * words. Before growing, the entries no block uses anymore are dropped, so the palette never
+ * holds more than one entry per block plus the one being added: 16 bits covers sections up to
+ * 40 blocks wide, past that indices go to 32 bits, as large as dense storage. Blocks use the
+ * FDenseBlockBuffer layout.
+ *
+ * Follows the Get/Set/FillBox/FillColumnSpan contract of FHierarchicalGrid, use
+ * ChooseBackend to pick whichever of the two is smaller for a given section.
+ */
+struct FPaletteSection
+{
+	explicit FPaletteSection(const uint8 InResolution = FGameConstants::ChunkSize,
+	                         const uint32 InBlockId = 0) : Resolution(InResolution)
+	{
+		Palette.Add(InBlockId);
+	}
+
+	uint8 Resolution = FGameConstants::ChunkSize;
+
+	uint8 BitsPerIndex = 0;
+
+	TArray<uint32> Palette;
+
+	TArray<uint64> Words;
+
+	bool IsUniform() const
+	{
+		return BitsPerIndex == 0;
+	}
+
+	uint32 Get(const uint8 X, const uint8 Y, const uint8 Z) const
+	{
+		if (IsUniform())
+		{
+			return Palette[0];
+		}
+
+		return Palette[ReadIndex(BlockIndex(X, Y, Z))];
+	}
+
+	void Set(const uint8 X, const uint8 Y, const uint8 Z, const uint32 InBlockId)
+	{
+		const uint32 PaletteIdx = FindOrAddPaletteIndex(InBlockId);
+		if (IsUniform())
+		{
+			return;
+		}
+
+		WriteIndex(BlockIndex(X, Y, Z), PaletteIdx);
+	}
+
+	/**
+	 * Set every block of the box (inclusive bounds)
+	 */
+	void FillBox(const FIntVector& Min, const FIntVector& Max, const uint32 InBlockId)
+	{
+		if (Min == FIntVector::ZeroValue && Max == FIntVector(Resolution - 1))
+		{
+			*this = FPaletteSection{Resolution, InBlockId};
+			return;
+		}
+
+		const uint32 PaletteIdx = FindOrAddPaletteIndex(InBlockId);
+		if (IsUniform())
+		{
+			return;
+		}
+
+		for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+		{
+			for (int32 X = Min.X; X <= Max.X; X++)
+			{
+				const int32 RowStart = BlockIndex(X, 0, Z);
+				for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+				{
+					WriteIndex(RowStart + Y, PaletteIdx);
+				}
+			}
+		}
+	}
+
+	void FillColumnSpan(const uint8 X, const uint8 Y, const uint8 MinZ, const uint8 MaxZ,
+	                    const uint32 InBlockId)
+	{
+		FillBox(FIntVector(X, Y, MinZ), FIntVector(X, Y, MaxZ), InBlockId);
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Palette.GetAllocatedSize() + Words.GetAllocatedSize();
+	}
+
+	void Decode(FDenseBlockBuffer& OutBuffer) const
+	{
+		OutBuffer.Reset(Resolution, Palette[0]);
+		if (IsUniform())
+		{
+			return;
+		}
+
+		for (int32 Idx = 0; Idx < OutBuffer.Blocks.Num(); Idx++)
+		{
+			OutBuffer.Blocks[Idx] = Palette[ReadIndex(Idx)];
+		}
+	}
+
+	static FPaletteSection FromDense(const FDenseBlockBuffer& Buffer)
+	{
+		FPaletteSection Section{Buffer.Resolution, Buffer.Blocks[0]};
+		for (int32 Idx = 0; Idx < Buffer.Blocks.Num(); Idx++)
+		{
+			const uint32 PaletteIdx = Section.FindOrAddPaletteIndex(Buffer.Blocks[Idx]);
+			if (!Section.IsUniform())
+			{
+				Section.WriteIndex(Idx, PaletteIdx);
+			}
+		}
+
+		return Section;
+	}
+
+	static FPaletteSection FromGrid(const FHierarchicalGrid& Grid)
+	{
+		if (Grid.IsUniform())
+		{
+			return FPaletteSection{Grid.Resolution, Grid.BlockId};
+		}
+
+		const auto Buffer = FDenseBlockBuffer::Acquire(Grid.Resolution);
+		FHierarchicalDenseCodec::Decode(Grid, *Buffer);
+		return FromDense(*Buffer);
+	}
+
+	void ToGrid(FHierarchicalGrid& OutGrid) const
+	{
+		if (IsUniform())
+		{
+			OutGrid = FHierarchicalGrid{Palette[0], Resolution};
+			return;
+		}
+
+		const auto Buffer = FDenseBlockBuffer::Acquire(Resolution);
+		Decode(*Buffer);
+		FHierarchicalDenseCodec::Encode(*Buffer, OutGrid);
+	}
+
+	/**
+	 * Drop palette entries no block uses anymore (Set never removes them), shrinking the
+	 * indices when possible
+	 */
+	void Compact()
+	{
+		if (IsUniform())
+		{
+			return;
+		}
+
+		const auto Buffer = FDenseBlockBuffer::Acquire(Resolution);
+		Decode(*Buffer);
+		*this = FromDense(*Buffer);
+	}
+
+	/**
+	 * Bits needed per index to address a palette of the given size
+	 */
+	static uint8 BitsForPaletteSize(const int32 PaletteSize)
+	{
+		if (PaletteSize <= 1)
+		{
+			return 0;
+		}
+
+		const uint32 Bits = FMath::CeilLogTwo(PaletteSize);
+		return static_cast<uint8>(FMath::RoundUpToPowerOfTwo(Bits));
+	}
+
+	static SIZE_T EstimateAllocatedSize(const int32 PaletteSize, const uint8 InResolution)
+	{
+		const uint32 BlockCount = InResolution * InResolution * InResolution;
+		const uint32 WordCount = FMath::DivideAndRoundUp<uint32>(
+			BlockCount * BitsForPaletteSize(PaletteSize), 64);
+		return PaletteSize * sizeof(uint32) + WordCount * sizeof(uint64);
+	}
+
+private:
+	int32 BlockIndex(const int32 X, const int32 Y, const int32 Z) const
+	{
+		return (Z * Resolution + X) * Resolution + Y;
+	}
+
+	uint32 ReadIndex(const int32 Idx) const
+	{
+		const uint32 Bit = Idx * BitsPerIndex;
+		const uint64 Mask = (uint64{1} << BitsPerIndex) - 1;
+		return static_cast<uint32>(Words[Bit / 64] >> (Bit % 64) & Mask);
+	}
+
+	void WriteIndex(const int32 Idx, const uint32 PaletteIdx)
+	{
+		const uint32 Bit = Idx * BitsPerIndex;
+		const uint64 Mask = (uint64{1} << BitsPerIndex) - 1;
+		uint64& Word = Words[Bit / 64];
+		Word = (Word & ~(Mask << (Bit % 64))) | (uint64{PaletteIdx} << (Bit % 64));
+	}
+
+	uint32 FindOrAddPaletteIndex(const uint32 InBlockId)
+	{
+		// Palettes are small, a linear search beats hashing
+		const int32 Existing = Palette.Find(InBlockId);
+		if (Existing != INDEX_NONE)
+		{
+			return Existing;
+		}
+
+		// Blocks overwritten since may have left entries unused, reuse their room first
+		uint8 NeededBits = BitsForPaletteSize(Palette.Num() + 1);
+		if (NeededBits > BitsPerIndex && !IsUniform() && DropUnusedPaletteEntries())
+		{
+			NeededBits = BitsForPaletteSize(Palette.Num() + 1);
+		}
+
+		const int32 PaletteIdx = Palette.Add(InBlockId);
+		if (NeededBits > BitsPerIndex)
+		{
+			Repack(NeededBits);
+		}
+
+		return PaletteIdx;
+	}
+
+	/**
+	 * Remap the indices to the palette entries still in use, keeping their order and the
+	 * index width. Returns false if every entry is used
+	 */
+	bool DropUnusedPaletteEntries()
+	{
+		const int32 BlockCount = Resolution * Resolution * Resolution;
+		TBitArray<> Used(false, Palette.Num());
+		for (int32 Idx = 0; Idx < BlockCount; Idx++)
+		{
+			Used[ReadIndex(Idx)] = true;
+		}
+
+		TArray<uint32> Remap;
+		Remap.SetNumUninitialized(Palette.Num());
+		int32 UsedCount = 0;
+		for (int32 PaletteIdx = 0; PaletteIdx < Palette.Num(); PaletteIdx++)
+		{
+			if (Used[PaletteIdx])
+			{
+				Remap[PaletteIdx] = UsedCount;
+				Palette[UsedCount++] = Palette[PaletteIdx];
+			}
+		}
+
+		if (UsedCount == Palette.Num())
+		{
+			return false;
+		}
+
+		Palette.SetNum(UsedCount, EAllowShrinking::No);
+		for (int32 Idx = 0; Idx < BlockCount; Idx++)
+		{
+			WriteIndex(Idx, Remap[ReadIndex(Idx)]);
+		}
+
+		return true;
+	}
+
+	void Repack(const uint8 NewBitsPerIndex)
+	{
+		const int32 BlockCount = Resolution * Resolution * Resolution;
+		TArray<uint64> OldWords = MoveTemp(Words);
+		const uint8 OldBitsPerIndex = BitsPerIndex;
+
+		BitsPerIndex = NewBitsPerIndex;
+		Words.SetNumZeroed(FMath::DivideAndRoundUp(BlockCount * NewBitsPerIndex, 64));
+
+		// Coming from uniform, every index is already 0
+		if (OldBitsPerIndex == 0)
+		{
+			return;
+		}
+
+		const uint64 OldMask = (uint64{1} << OldBitsPerIndex) - 1;
+		for (int32 Idx = 0; Idx < BlockCount; Idx++)
+		{
+			const uint32 OldBit = Idx * OldBitsPerIndex;
+			WriteIndex(Idx, static_cast<uint32>(OldWords[OldBit / 64] >> (OldBit % 64) & OldMask));
+		}
+	}
+};
+
+enum class EChunkSectionBackend : uint8
+{
+	Hierarchical,
+	Palette
+};
+
+/**
+ * Storage that would hold the given section in less memory
+ */
+inline EChunkSectionBackend ChooseBackend(const FHierarchicalGrid& Grid)
+{
+	if (Grid.IsUniform())
+	{
+		return EChunkSectionBackend::Hierarchical;
+	}
+
+	const auto Buffer = FDenseBlockBuffer::Acquire(Grid.Resolution);
+	FHierarchicalDenseCodec::Decode(Grid, *Buffer);
+
+	TSet<uint32> Distinct;
+	for (const uint32 Block : Buffer->Blocks)
+	{
+		Distinct.Add(Block);
+	}
+
+	return FPaletteSection::EstimateAllocatedSize(Distinct.Num(), Grid.Resolution) <
+	       Grid.GetAllocatedSize()
+		       ? EChunkSectionBackend::Palette
+		       : EChunkSectionBackend::Hierarchical;
+}
@@ -0,0 +1,144 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "MultiThreadTest/Constants/GameConstants.h"
+
+/**
+ * Helpers shared by the span arrays of every hierarchical level (layers, rows and cols).
+ * Spans are stored in order and their Span adds up to the resolution of the parent
+ */
+struct FSpanArray
+{
+	static_assert(FGameConstants::ChunkSize <= 16, "Span starts are stored in a 16 bit mask");
+
+	/**
+	 * Bit N of the mask is set when a span starts at position N
+	 */
+	template <typename T, typename AllocatorType>
+	static uint16 BuildStarts(const TArray<T, AllocatorType>& Spans)
+	{
+		uint16 Starts = 0;
+		uint8 Start = 0;
+		for (const auto& Span : Spans)
+		{
+			Starts |= 1 << Start;
+			Start += Span.Span;
+		}
+
+		return Starts;
+	}
+
+	/**
+	 * Index of the span covering Pos, and the position that span starts at. Uses the starts
+	 * mask when it is built (a mask and two bit scans), walks the spans otherwise.
+	 * Returns INDEX_NONE when Pos is past the last span
+	 */
+	template <typename T, typename AllocatorType>
+	static int32 Find(const TArray<T, AllocatorType>& Spans, const uint16 Starts, const uint8 Pos,
+	                  uint8& OutStartPos)
+	{
+		if (Starts)
+		{
+			const uint32 StartsUpToPos = Starts & ((2u << Pos) - 1);
+			const int32 Idx = FMath::CountBits(StartsUpToPos) - 1;
+			OutStartPos = static_cast<uint8>(FMath::FloorLog2(StartsUpToPos));
+
+			// The last span still has to reach Pos
+			return OutStartPos + Spans[Idx].Span > Pos ? Idx : INDEX_NONE;
+		}
+
+		uint8 Start = 0;
+		for (int32 Idx = 0; Idx < Spans.Num(); Idx++)
+		{
+			if (Start + Spans[Idx].Span > Pos)
+			{
+				OutStartPos = Start;
+				return Idx;
+			}
+
+			Start += Spans[Idx].Span;
+		}
+
+		return INDEX_NONE;
+	}
+
+	/**
+	 * Make sure a span starts exactly at At, splitting the one that covers it if needed
+	 * (both halves keep the same content). Returns the index of the span starting at At,
+	 * or Spans.Num() when At is the end of the array
+	 */
+	template <typename T, typename AllocatorType>
+	static int32 SplitAt(TArray<T, AllocatorType>& Spans, const uint8 At)
+	{
+		uint8 Start = 0;
+		for (int32 Idx = 0; Idx < Spans.Num(); Idx++)
+		{
+			if (Start == At)
+			{
+				return Idx;
+			}
+
+			const uint8 End = Start + Spans[Idx].Span;
+			if (At < End)
+			{
+				T After = Spans[Idx];
+				After.Span = End - At;
+				Spans[Idx].Span = At - Start;
+				Spans.Insert(MoveTemp(After), Idx + 1);
+				return Idx + 1;
+			}
+
+			Start = End;
+		}
+
+		return Spans.Num();
+	}
+
+	/**
+	 * Merge every run of adjacent spans holding the same content, in a single pass whatever
+	 * the level. Returns how many spans were removed
+	 */
+	template <typename T, typename AllocatorType>
+	static int32 Merge(TArray<T, AllocatorType>& Spans)
+	{
+		if (Spans.Num() < 2)
+		{
+			return 0;
+		}
+
+		int32 Last = 0;
+		for (int32 Idx = 1; Idx < Spans.Num(); Idx++)
+		{
+			if (Spans[Last].HasSameContent(Spans[Idx]))
+			{
+				Spans[Last].Span += Spans[Idx].Span;
+			}
+			else if (++Last != Idx)
+			{
+				Spans[Last] = MoveTemp(Spans[Idx]);
+			}
+		}
+
+		const int32 Removed = Spans.Num() - Last - 1;
+		Spans.SetNum(Last + 1, EAllowShrinking::No);
+		return Removed;
+	}
+
+	/**
+	 * Merge the spans between FirstIdx and LastIdx (and their outer neighbours) that hold
+	 * the same content as the span before them
+	 */
+	template <typename T, typename AllocatorType>
+	static void Coalesce(TArray<T, AllocatorType>& Spans, const int32 FirstIdx, const int32 LastIdx)
+	{
+		const int32 From = FMath::Max(FirstIdx, 1);
+		for (int32 Idx = FMath::Min(LastIdx + 1, Spans.Num() - 1); Idx >= From; Idx--)
+		{
+			if (Spans[Idx - 1].HasSameContent(Spans[Idx]))
+			{
+				Spans[Idx - 1].Span += Spans[Idx].Span;
+				Spans.RemoveAt(Idx);
+			}
+		}
+	}
+};
@@ -0,0 +1,30 @@
+﻿#include "TerrainNoise.h"
+
+#include "FastNoiseWrapper.h"
+
+FTerrainNoise::FTerrainNoise(const int32 Seed, const float Frequency, const int32 Octaves) :
+	Noise(NewObject<UFastNoiseWrapper>())
+{
+	Noise->SetupFastNoise(EFastNoise_NoiseType::SimplexFractal, Seed, Frequency,
+	                      EFastNoise_Interp::Quintic, EFastNoise_FractalType::FBM, Octaves);
+}
+
+FTerrainNoise::~FTerrainNoise() = default;
+
+void FTerrainNoise::SampleGrid(const FVector2f& Origin, const float Step, const int32 Size,
+                               TArrayView<float> OutValues) const
+{
+	checkf(OutValues.Num() >= Size * Size, TEXT("Output too small for a %dx%d grid"), Size, Size);
+
+	// FastNoise only has a scalar API, so the batch is what we can shape: one call per
+	// column with contiguous output and no per sample setup
+	float* Out = OutValues.GetData();
+	for (int32 X = 0; X < Size; X++)
+	{
+		const float SampleX = Origin.X + X * Step;
+		for (int32 Y = 0; Y < Size; Y++)
+		{
+			*Out++ = Noise->GetNoise2D(SampleX, Origin.Y + Y * Step);
+		}
+	}
+}
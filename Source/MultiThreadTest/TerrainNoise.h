@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/StrongObjectPtr.h"
+
+class UFastNoiseWrapper;
+
+/**
+ * Noise generator owned by a single worker, so workers never share (or contend on) noise
+ * state. It owns a UObject, create and destroy it on the game thread.
+ */
+class FTerrainNoise
+{
+public:
+	FTerrainNoise(int32 Seed, float Frequency, int32 Octaves);
+
+	~FTerrainNoise();
+
+	/**
+	 * Sample a Size x Size grid of 2D noise in one call, starting at Origin with Step
+	 * between samples. Values are in [-1, 1] and written X major (OutValues[X * Size + Y])
+	 */
+	void SampleGrid(const FVector2f& Origin, float Step, int32 Size,
+	                TArrayView<float> OutValues) const;
+
+private:
+	TStrongObjectPtr<UFastNoiseWrapper> Noise;
+};
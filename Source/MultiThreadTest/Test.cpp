@@ -4,11 +4,35 @@
 #include "Test.h"
 
 #include "ChunkHelper.h"
+#include "ChunkRegistry.h"
+#include "ChunkTrace.h"
+#include "ChunksStat.h"
+#include "EngineUtils.h"
 #include "LoadChunkRunnable.h"
+#include "Kismet/GameplayStatics.h"
 #include "WorldGenerator.h"
 #include "WorldGenerator.h"
 #include "Constants/GameConstants.h"
 
+namespace
+{
+	FAutoConsoleCommandWithWorld GDumpChunkMemoryCommand(
+		TEXT("Chunks.DumpMemory"),
+		TEXT("Log the memory used by the registered columns of every chunk actor"),
+		FConsoleCommandWithWorldDelegate::CreateLambda(
+			[](UWorld* World)
+			{
+				for (TActorIterator<ATest> It(World); It; ++It)
+				{
+					if (It->ChunkRegistry)
+					{
+						UE_LOG(LogTemp, Display, TEXT("%s:"), *It->GetName());
+						It->ChunkRegistry->GetMemoryStats().Dump(*GLog);
+					}
+				}
+			}));
+}
+
 
 // Sets default values
 ATest::ATest()
@@ -16,8 +40,10 @@ ATest::ATest()
 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
-	LoadColumnQueue = MakeShared<TThreadSafeQueue<FIntVector2>>();
-	CreateColumnQueue = MakeShared<TThreadSafeQueue<FChunkDataColumn>>();
+	JobQueue = MakeShared<TMpmcQueue<FColumnJob>>();
+	JobDepths = MakeShared<FColumnJobDepths>();
+	CreateColumnQueue = MakeShared<TMpmcQueue<FChunkDataColumn>>();
+	MeshQueue = MakeShared<TMpmcQueue<FChunkMesh>>(4096);
 }
 
 // Called when the game starts or when spawned
@@ -27,23 +53,56 @@ void ATest::BeginPlay()
 
 	const auto WorldGenerator = NewObject<UWorldGenerator>();
 
+	RegionStore = MakeShared<FRegionStore>(
+		FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Regions")),
+		WorldGenerator->GetSettingsHash());
+
+	ChunkRegistry = NewObject<UChunkRegistry>(this);
+	JobGraph = MakeUnique<FColumnJobGraph>(ChunkRegistry);
+
 	const auto LoadChunkRunnablesAndThreads = FLoadChunkRunnable::Create(
-		WorldGenerator, LoadColumnQueue, CreateColumnQueue, 24);
+		WorldGenerator, JobQueue, JobDepths, CreateColumnQueue, RegionStore, MeshQueue, ChunkRegistry,
+		FMath::Max(WorkerCount, 1));
 	LoadChunkRunnables = LoadChunkRunnablesAndThreads.Runnables;
 	LoadChunkThreads = LoadChunkRunnablesAndThreads.Threads;
 
-	const auto PlayerPos = FVector{0,0,0};
-	const auto PlayerColPos = UChunkHelper::ToChunkPos(PlayerPos);
+	// The first update requests the whole square around the player, the next ones only the
+	// strips it walks into
+	UpdateStreaming();
+	LoadScheduler.Dispatch(*JobQueue, *JobDepths,
+	                       LoadChunkRunnables.Num() * FGameConstants::LoadQueueDepthPerWorker);
+}
+
+void ATest::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Signal every worker first so they wind down in parallel, then join them one by one
+	for (const auto Runnable : LoadChunkRunnables)
+	{
+		Runnable->Stop();
+	}
+
+	for (const auto Thread : LoadChunkThreads)
+	{
+		Thread->Kill(true);
+		delete Thread;
+	}
 
-	const auto PosAroundPlayer = UChunkHelper::GetPositionsAround(
-		PlayerColPos,
-		FGameConstants::DefaultUnloadedDistance - 1
-	);
+	for (const auto Runnable : LoadChunkRunnables)
+	{
+		delete Runnable;
+	}
+
+	LoadChunkThreads.Empty();
+	LoadChunkRunnables.Empty();
 
-	for (const auto& Pos : PosAroundPlayer)
+	// Every worker is gone, nobody is saving anymore
+	if (RegionStore)
 	{
-		LoadColumnQueue->Enqueue(Pos);
+		RegionStore->Flush();
+		RegionStore.Reset();
 	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -51,12 +110,127 @@ void ATest::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	GEngine->AddOnScreenDebugMessage(0, 0.1f, FColor::Blue, FString::Printf(TEXT("Count: %d"), Count));
+	// Before the integration drains it, so the depth is what the workers left behind
+	FChunkTrace::QueueDepths(JobQueue->Num(), CreateColumnQueue->Num(), MeshQueue->Num(),
+	                         Integrator.NumStaged());
+
+	UpdateStreaming();
+
+	Integrator.Tick(*CreateColumnQueue, UChunkHelper::ToChunkPos(GetPlayerPosition()),
+	                IntegrationBudgetMs,
+	                [this](const FChunkDataColumn& Column)
+	                {
+		                // A column evicted while in flight and entering again is dispatched
+		                // again, only the latest dispatch's result is kept
+		                return Streamer.IsInRange(Column.ColumnPos) &&
+			                LoadScheduler.GetDispatchCycles(Column.ColumnPos) == Column.DispatchCycles;
+	                },
+	                [this](FChunkDataColumn&& Column)
+	                {
+		                const FIntVector2 ColumnPos = Column.ColumnPos;
+		                if (const uint64 DispatchCycles = LoadScheduler.GetDispatchCycles(ColumnPos))
+		                {
+			                FChunkTrace::ColumnIntegrated(
+				                ColumnPos, FPlatformTime::Cycles64() - DispatchCycles);
+		                }
+
+		                LoadScheduler.MarkLoaded(ColumnPos, Column.GetResolution());
+		                ChunkRegistry->Register(MoveTemp(Column));
+		                JobGraph->OnColumnRegistered(ColumnPos);
+		                Count++;
+	                });
+
+	// Mesh jobs first, they only wait on data that is already there. Only as many as the mesh
+	// queue has room for, counting every section of the ones waiting or running, so the
+	// workers never wait on the game thread to hand their meshes over
+	const int32 MeshQueueRoom = (static_cast<int32>(MeshQueue->Capacity()) - MeshQueue->Num()) /
+		FGameConstants::ChunksInZ - LoadChunkRunnables.Num();
+	const int32 MeshJobs = FMath::Min(LoadChunkRunnables.Num() * FGameConstants::MeshQueueDepthPerWorker,
+	                                  MeshQueueRoom) - JobDepths->Num(EColumnJobKind::Mesh);
+	JobGraph->Dispatch(*JobQueue, *JobDepths, MeshJobs, [this](const FIntVector2& ColumnPos)
+	{
+		return LoadScheduler.DistanceTo(ColumnPos);
+	});
+
+	// Keep only a couple of columns per worker in flight, so what's still pending can be
+	// re-prioritized as the player moves
+	LoadScheduler.Dispatch(*JobQueue, *JobDepths,
+	                       LoadChunkRunnables.Num() * FGameConstants::LoadQueueDepthPerWorker);
+
+#if STATS
+	const FChunkMemoryStats Memory = ChunkRegistry->GetMemoryStats();
+	SET_MEMORY_STAT(STAT_ChunkColumnMemory, Memory.GetTotalBytes());
+	SET_DWORD_STAT(STAT_ChunkRegisteredColumns, Memory.Columns);
+	SET_FLOAT_STAT(STAT_ChunkBytesPerColumn, Memory.GetBytesPerColumn());
+	SET_FLOAT_STAT(STAT_ChunkSpansPerSection, Memory.GetSpansPerSection());
+	SET_FLOAT_STAT(STAT_ChunkCompressionRatio, Memory.GetCompressionRatio());
+	SET_MEMORY_STAT(STAT_RegionSavedMemory, RegionStore ? RegionStore->GetSavedBytes() : 0);
+
+	const uint64 ColumnCopies = FChunkCopyCounters::ColumnCopies.load(std::memory_order_relaxed);
+	const uint64 SectionCopies = FChunkCopyCounters::SectionCopies.load(std::memory_order_relaxed);
+	SET_DWORD_STAT(STAT_ChunkColumnCopies, ColumnCopies);
+	SET_DWORD_STAT(STAT_ChunkSectionCopies, SectionCopies);
+	SET_FLOAT_STAT(STAT_ChunkColumnCopiesPerColumn, Count ? static_cast<double>(ColumnCopies) / Count : 0);
+	SET_FLOAT_STAT(STAT_ChunkSectionCopiesPerColumn, Count ? static_cast<double>(SectionCopies) / Count : 0);
+#endif
+
+	GEngine->AddOnScreenDebugMessage(0, 0.1f, FColor::Blue,
+	                                 FString::Printf(TEXT("Count: %d, Loaded: %d, Backlog: %d, Triangles: %lld"),
+	                                                 Count, LoadScheduler.NumLoaded(),
+	                                                 Integrator.NumStaged(), TriangleCount));
+
+	// Nothing renders the meshes yet, they go back to their pool once counted. At least one
+	// per tick so the queue always moves
+	const double MeshDrainEnd = FPlatformTime::Seconds() + MeshDrainBudgetMs / 1000.0;
+	do
+	{
+		TOptional<FChunkMesh> Mesh = MeshQueue->Dequeue();
+		if (!Mesh.IsSet())
+		{
+			break;
+		}
+
+		ChunkRegistry->SetState({Mesh->ChunkPos.X, Mesh->ChunkPos.Y}, EColumnState::Live);
+		TriangleCount += Mesh->Data->NumTriangles();
+	}
+	while (FPlatformTime::Seconds() < MeshDrainEnd);
+}
+
+void ATest::UpdateStreaming()
+{
+	EnteredColumns.Reset();
+	EvictedColumns.Reset();
+	if (!Streamer.Update(GetPlayerPosition(), LoadScheduler, EnteredColumns, EvictedColumns))
+	{
+		return;
+	}
+
+	for (const auto& ColumnPos : EvictedColumns)
+	{
+		ChunkRegistry->Remove(ColumnPos);
+		JobGraph->OnColumnRemoved(ColumnPos);
+	}
+
+	for (const auto& ColumnPos : EnteredColumns)
+	{
+		ChunkRegistry->Add(ColumnPos);
+	}
+}
 
-	if (!CreateColumnQueue->IsEmpty())
+bool ATest::ApplyEdits(const FIntVector2& ColumnPos, const int32 ChunkZ, const TArray<FBlockEdit>& Edits)
+{
+	if (!ChunkRegistry->ApplyEdits(ColumnPos, ChunkZ, Edits))
 	{
-		CreateColumnQueue->Dequeue();
-		Count++;
+		return false;
 	}
+
+	// Meshed again from the new version, and so are the neighbors' seams
+	JobGraph->OnColumnRegistered(ColumnPos);
+	return true;
 }
 
+FVector ATest::GetPlayerPosition() const
+{
+	const auto PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0);
+	return PlayerPawn ? PlayerPawn->GetActorLocation() : FVector::ZeroVector;
+}
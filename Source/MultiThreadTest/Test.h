@@ -3,12 +3,20 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "ThreadSafeQueue.h"
+#include "ChunkMeshData.h"
+#include "ColumnIntegrator.h"
+#include "ColumnJobGraph.h"
+#include "ColumnLoadScheduler.h"
+#include "ColumnStreamer.h"
+#include "MpmcQueue.h"
+#include "RegionStore.h"
+#include "Structs/BlockEdit.h"
 #include "GameFramework/Actor.h"
 #include "Test.generated.h"
 
 struct FChunkDataColumn;
 class FLoadChunkRunnable;
+class UChunkRegistry;
 
 UCLASS()
 class MULTITHREADTEST_API ATest : public AActor
@@ -23,20 +31,101 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
-	TSharedPtr<TThreadSafeQueue<FIntVector2>> LoadColumnQueue;
+	FVector GetPlayerPosition() const;
+
+	/**
+	 * Follow the player with the streamer, and keep the registry and the job graph in sync
+	 * with what it added and evicted
+	 */
+	void UpdateStreaming();
+
+	/**
+	 * Write a batch of blocks to a section of a loaded column and mesh it again, see
+	 * UChunkRegistry::ApplyEdits. Returns false if nothing changed
+	 */
+	bool ApplyEdits(const FIntVector2& ColumnPos, int32 ChunkZ, const TArray<FBlockEdit>& Edits);
+
+	/**
+	 * Columns waiting to be loaded, fed to JobQueue nearest first
+	 */
+	FColumnLoadScheduler LoadScheduler;
+
+	/**
+	 * Decides which columns are wanted around the player, feeds LoadScheduler
+	 */
+	FColumnStreamer Streamer;
+
+	/**
+	 * Columns added and evicted by the last streamer update, reused every tick
+	 */
+	TArray<FIntVector2> EnteredColumns;
+
+	TArray<FIntVector2> EvictedColumns;
+
+	/**
+	 * State of every wanted column and data of the integrated ones, shared with the workers
+	 */
+	UPROPERTY()
+	TObjectPtr<UChunkRegistry> ChunkRegistry;
+
+	/**
+	 * Releases the mesh jobs as columns are registered and evicted
+	 */
+	TUniquePtr<FColumnJobGraph> JobGraph;
+
+	/**
+	 * Generate and mesh jobs for the workers
+	 */
+	TSharedPtr<TMpmcQueue<FColumnJob>> JobQueue;
+
+	/**
+	 * Jobs of each kind in JobQueue, each kind is dispatched against its own depth
+	 */
+	TSharedPtr<FColumnJobDepths> JobDepths;
 	
 	/**
 	 * List of chunks to create with their chunk data
 	 */
-	TSharedPtr<TThreadSafeQueue<FChunkDataColumn>> CreateColumnQueue;
+	TSharedPtr<TMpmcQueue<FChunkDataColumn>> CreateColumnQueue;
+
+	/**
+	 * Drains CreateColumnQueue within IntegrationBudgetMs per frame
+	 */
+	FColumnIntegrator Integrator;
+
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	float IntegrationBudgetMs = FGameConstants::IntegrationBudgetMs;
+
+	/**
+	 * Generation workers, see the Scaling benchmark to size it for a machine
+	 */
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (ClampMin = 1))
+	int32 WorkerCount = FGameConstants::ChunkRenderingThreads;
+
+	/**
+	 * Section meshes ready to be uploaded, drained within MeshDrainBudgetMs per frame
+	 */
+	TSharedPtr<TMpmcQueue<FChunkMesh>> MeshQueue;
+
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	float MeshDrainBudgetMs = FGameConstants::MeshDrainBudgetMs;
+
+	/**
+	 * Generated columns cached on disk, written as they pile up and when play ends
+	 */
+	TSharedPtr<FRegionStore> RegionStore;
 
 	TArray<FLoadChunkRunnable*> LoadChunkRunnables;
 
 	TArray<FRunnableThread*> LoadChunkThreads;
 	
 	int Count = 0;
+
+	int64 TriangleCount = 0;
 };
@@ -5,15 +5,15 @@ template <typename T>
 class TThreadSafeQueue
 {
 public:
-	void Enqueue(const T Item)
+	void Enqueue(T Item)
 	{
 		FScopeLock Lock(&CriticalSection);
-		Queue.Add(Item);
+		Queue.Add(MoveTemp(Item));
 	}
 
-	void EnqueueWithoutLock(const T&& Item)
+	void EnqueueWithoutLock(T&& Item)
 	{
-		Queue.Add(Item);
+		Queue.Add(MoveTemp(Item));
 	}
 
 	T Dequeue()
@@ -3,41 +3,162 @@
 #include "WorldGenerator.h"
 
 #include "ChunksStat.h"
+#include "ChunkTrace.h"
+#include "TerrainNoise.h"
 #include "Constants/GameConstants.h"
 #include "Structs/HierarchialGrid.h"
 
-void UWorldGenerator::Generate(FIntVector2 ChunkPos, TArray<FHierarchicalGrid>& OutChunkData)
+TUniquePtr<FTerrainNoise> UWorldGenerator::CreateNoise() const
+{
+	check(IsInGameThread());
+	return MakeUnique<FTerrainNoise>(Seed, Frequency, Octaves);
+}
+
+uint32 UWorldGenerator::GetSettingsHash() const
+{
+	return HashCombine(HashCombine(GetTypeHash(Seed), GetTypeHash(Frequency)),
+	                   GetTypeHash(Octaves));
+}
+
+void UWorldGenerator::GenerateColumn(const FIntVector2 ColumnPos, const FTerrainNoise& Noise,
+                                     FChunkDataColumn& OutColumn, const uint8 Resolution)
 {
-	OutChunkData.SetNum(FGameConstants::ChunksInZ);
 	SCOPE_CYCLE_COUNTER(STAT_GenerateChunkGen);
 
-	for (int X = 0; X < FGameConstants::ChunkSize; X++)
+	checkf(FMath::IsPowerOfTwo(Resolution) && Resolution <= FGameConstants::ChunkSize,
+	       TEXT("Invalid resolution %d"), Resolution);
+
+	OutColumn.ColumnPos = ColumnPos;
+	OutColumn.ChunkDatas.Reset();
+	OutColumn.ChunkDatas.Init(FHierarchicalGrid{Resolution}, FGameConstants::ChunksInZ);
+
+	constexpr int32 MaxSize = FGameConstants::ChunkSize * FGameConstants::ChunkSize;
+	TStaticArray<int32, MaxSize> Heights;
+	const TArrayView<int32> ColumnHeights{Heights.GetData(), Resolution * Resolution};
+	int32 MinHeight = MAX_int32;
+	int32 MaxHeight = 0;
+
 	{
-		for (int Y = 0; Y < FGameConstants::ChunkSize; Y++)
+		SCOPE_CYCLE_COUNTER(STAT_GenerateChunkGenXY);
+		SampleHeights(ColumnPos, Noise, ColumnHeights, Resolution);
+		for (const int32 Height : ColumnHeights)
+		{
+			MinHeight = FMath::Min(MinHeight, Height);
+			MaxHeight = FMath::Max(MaxHeight, Height);
+		}
+	}
+
+	// Heights are in voxels, the column's are in world blocks
+	const int32 BlocksPerVoxel = FGameConstants::ChunkSize / Resolution;
+	OutColumn.Heights.Min = MinHeight * BlocksPerVoxel;
+	OutColumn.Heights.Max = MaxHeight * BlocksPerVoxel;
+
+	for (int ChunkZ = 0; ChunkZ < FGameConstants::ChunksInZ; ChunkZ++)
+	{
+		const int32 WorldChunkZ = ChunkZ * Resolution;
+
+		// Fully above the terrain, the default grid is already uniform air
+		if (WorldChunkZ >= MaxHeight)
 		{
-			SCOPE_CYCLE_COUNTER(STAT_GenerateChunkGenXY);
+			break;
+		}
 
-			constexpr float NoiseValue = 0.5;
+		FHierarchicalGrid& Grid = OutColumn.ChunkDatas[ChunkZ];
 
-			const int Height = FMath::RoundToInt(
-				(NoiseValue + 1) * (FGameConstants::WorldHeight / 2));
+		// Fully below the terrain, no need to touch a single voxel
+		if (WorldChunkZ + Resolution <= MinHeight)
+		{
+			Grid = FHierarchicalGrid{1u, Resolution};
+			continue;
+		}
 
-			for (
-				int ChunkZ = 0;
-				ChunkZ < FMath::CeilToInt(Height / static_cast<float>(FGameConstants::ChunkSize));
-				ChunkZ++
-			)
+		SCOPE_CYCLE_COUNTER(STAT_GenerateChunkSet);
+		CHUNK_TRACE_SECTION_SCOPE(ChunkGenerateSection);
+
+		// Everything under the lowest point of the column is one box, only what sticks out
+		// above it is written per XY
+		const int32 SolidTop = MinHeight - WorldChunkZ;
+		if (SolidTop > 0)
+		{
+			Grid.FillBox(FIntVector(0, 0, 0),
+			             FIntVector(Resolution - 1, Resolution - 1, SolidTop - 1), 1);
+		}
+
+		for (int X = 0; X < Resolution; X++)
+		{
+			for (int Y = 0; Y < Resolution; Y++)
 			{
-				const int WorldChunkZ = ChunkZ * FGameConstants::ChunkSize;
-				const auto MaxHeightInThisChunk = FMath::Min(Height - WorldChunkZ,
-				                                             FGameConstants::ChunkSize);
+				const auto MaxHeightInThisChunk = FMath::Min<int32>(
+					ColumnHeights[X * Resolution + Y] - WorldChunkZ, Resolution);
 
-				for (int Z = 0; Z < MaxHeightInThisChunk; Z++)
+				const int32 MinZ = FMath::Max(SolidTop, 0);
+				if (MaxHeightInThisChunk > MinZ)
 				{
-					SCOPE_CYCLE_COUNTER(STAT_GenerateChunkSet);
-					OutChunkData[ChunkZ].Set(X, Y, Z, 1);
+					Grid.FillColumnSpan(X, Y, MinZ, MaxHeightInThisChunk - 1, 1);
 				}
 			}
 		}
 	}
 }
+
+void UWorldGenerator::SampleHeights(const FIntVector2 ColumnPos, const FTerrainNoise& Noise,
+                                    TArrayView<int32> OutHeights, const uint8 Resolution)
+{
+	constexpr int32 ChunkSize = FGameConstants::ChunkSize;
+	const int32 BlocksPerVoxel = ChunkSize / Resolution;
+
+	// Sample at the middle of every voxel, a full resolution voxel is a single block
+	const float Step = BlocksPerVoxel;
+	const float Offset = (BlocksPerVoxel - 1) / 2.f;
+
+	TStaticArray<float, ChunkSize * ChunkSize> NoiseValues;
+	Noise.SampleGrid(FVector2f(ColumnPos.X * ChunkSize + Offset, ColumnPos.Y * ChunkSize + Offset),
+	                 Step, Resolution, NoiseValues);
+
+	const int32 WorldHeight = FGameConstants::WorldHeight / BlocksPerVoxel;
+	for (int32 Idx = 0; Idx < Resolution * Resolution; Idx++)
+	{
+		const float HeightInBlocks = (NoiseValues[Idx] + 1) * (FGameConstants::WorldHeight / 2);
+		OutHeights[Idx] = FMath::Clamp(FMath::RoundToInt(HeightInBlocks / BlocksPerVoxel), 1,
+		                               WorldHeight);
+	}
+}
+
+void UWorldGenerator::Generate(FIntVector2 ChunkPos, TArray<FHierarchicalGrid>& OutChunkData)
+{
+	// Default grids are uniform air and own nothing, the sections above the surface stay so
+	OutChunkData.Reset();
+	OutChunkData.SetNum(FGameConstants::ChunksInZ);
+	SCOPE_CYCLE_COUNTER(STAT_GenerateChunkGen);
+
+	constexpr float NoiseValue = 0.5;
+	const int Height = FMath::RoundToInt((NoiseValue + 1) * (FGameConstants::WorldHeight / 2));
+
+	// Fully under the surface, uniform solid without touching a voxel
+	const int FullSections = FMath::Min(Height / FGameConstants::ChunkSize,
+	                                    FGameConstants::ChunksInZ);
+	for (int ChunkZ = 0; ChunkZ < FullSections; ChunkZ++)
+	{
+		OutChunkData[ChunkZ] = FHierarchicalGrid{1u};
+	}
+
+	const int SurfaceHeight = Height - FullSections * FGameConstants::ChunkSize;
+	if (FullSections == FGameConstants::ChunksInZ || SurfaceHeight == 0)
+	{
+		return;
+	}
+
+	for (int X = 0; X < FGameConstants::ChunkSize; X++)
+	{
+		for (int Y = 0; Y < FGameConstants::ChunkSize; Y++)
+		{
+			CHUNK_VOXEL_CYCLE_COUNTER(STAT_GenerateChunkGenXY);
+
+			for (int Z = 0; Z < SurfaceHeight; Z++)
+			{
+				CHUNK_VOXEL_CYCLE_COUNTER(STAT_GenerateChunkSet);
+				OutChunkData[FullSections].Set(X, Y, Z, 1);
+			}
+		}
+	}
+}
@@ -3,10 +3,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ChunkDataColumn.h"
 #include "Structs/HierarchialGrid.h"
 #include "WorldGenerator.generated.h"
 
-class UFastNoiseWrapper;
+class FTerrainNoise;
 
 /**
  * 
@@ -17,5 +18,50 @@ class MULTITHREADTEST_API UWorldGenerator : public UObject
 	GENERATED_BODY()
 
 public:
+	UPROPERTY(EditAnywhere, Category = "Noise")
+	int32 Seed = 1337;
+
+	UPROPERTY(EditAnywhere, Category = "Noise")
+	float Frequency = 0.01f;
+
+	UPROPERTY(EditAnywhere, Category = "Noise")
+	int32 Octaves = 4;
+
+	/**
+	 * Noise state for one worker, configured from this generator. Call it on the game thread
+	 */
+	TUniquePtr<FTerrainNoise> CreateNoise() const;
+
+	/**
+	 * Changes whenever the settings would generate a different world, so columns cached on
+	 * disk (FRegionStore) for other settings are ignored
+	 */
+	uint32 GetSettingsHash() const;
+
+	/**
+	 * Generate every section of the column in a single sweep, the height field is
+	 * sampled once per column and written straight into OutColumn.ChunkDatas.
+	 * Noise must be owned by the calling thread.
+	 *
+	 * Below full resolution the noise is only sampled once per voxel and the sections are
+	 * built at that resolution directly, so far columns cost a fraction of a full one
+	 */
+	virtual void GenerateColumn(FIntVector2 ColumnPos, const FTerrainNoise& Noise,
+	                            FChunkDataColumn& OutColumn,
+	                            uint8 Resolution = FGameConstants::ChunkSize);
+
+	/**
+	 * Terrain height of Resolution x Resolution evenly spaced XY of the column, X major.
+	 * Heights are in voxels of that resolution
+	 */
+	static void SampleHeights(FIntVector2 ColumnPos, const FTerrainNoise& Noise,
+	                          TArrayView<int32> OutHeights,
+	                          uint8 Resolution = FGameConstants::ChunkSize);
+
+	/**
+	 * Per voxel generation of the surface section, the ones under it are uniform solid and
+	 * the ones above uniform air. Kept as the baseline of the generation benchmark, use
+	 * GenerateColumn instead
+	 */
 	virtual void Generate(FIntVector2 ChunkPos, TArray<FHierarchicalGrid>& OutChunkData);
 };